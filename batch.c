@@ -0,0 +1,135 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "batch.h"
+
+/* Call "fn" on each of the work items read from "fd"
+ * until "fd" has been exhausted.
+ * Each work item is an integer written by batch_foreach in a single
+ * write and is therefore also read back in a single read,
+ * even if several workers are reading from "fd" at the same time.
+ *
+ * Return 0 if all calls to "fn" succeeded and 1 otherwise.
+ */
+static int batch_worker(int fd, int (*fn)(int i, void *user), void *user)
+{
+	int i;
+	int failed = 0;
+
+	while (read(fd, &i, sizeof(i)) == sizeof(i))
+		if (fn(i, user) < 0)
+			failed = 1;
+
+	return failed;
+}
+
+/* Call "fn" on each integer i in [0, n).
+ * If "n_job" is greater than one, then the calls are distributed
+ * over (at most) "n_job" worker processes.
+ * Each worker process performs its calls independently of the others,
+ * using its own isl_ctx and its own clang setup (as inherited from
+ * the caller at the time of the fork), such that "fn" does not need
+ * to be thread-safe.
+ * The work items are handed out through a pipe such that a worker
+ * that finishes its current item early can immediately pick up
+ * the next one.
+ *
+ * Return 0 if all calls to "fn" succeeded and -1 otherwise.
+ */
+int batch_foreach(int n, int n_job, int (*fn)(int i, void *user), void *user)
+{
+	int fd[2];
+	int i;
+	int n_started = 0;
+	int failed = 0;
+
+	if (n_job > n)
+		n_job = n;
+	if (n_job <= 1) {
+		for (i = 0; i < n; ++i)
+			if (fn(i, user) < 0)
+				failed = 1;
+		return failed ? -1 : 0;
+	}
+
+	if (pipe(fd) < 0) {
+		perror("pipe");
+		return -1;
+	}
+
+	fflush(stdout);
+	fflush(stderr);
+	for (i = 0; i < n_job; ++i) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			perror("fork");
+			break;
+		}
+		if (pid == 0) {
+			close(fd[1]);
+			_exit(batch_worker(fd[0], fn, user));
+		}
+		++n_started;
+	}
+	close(fd[0]);
+
+	if (n_started == 0)
+		failed = 1;
+	for (i = 0; n_started > 0 && i < n; ++i)
+		if (write(fd[1], &i, sizeof(i)) != sizeof(i)) {
+			perror("write");
+			failed = 1;
+			break;
+		}
+	close(fd[1]);
+
+	for (i = 0; i < n_started; ++i) {
+		int status;
+
+		if (wait(&status) < 0) {
+			perror("wait");
+			failed = 1;
+			break;
+		}
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			failed = 1;
+	}
+
+	return failed ? -1 : 0;
+}
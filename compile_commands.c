@@ -0,0 +1,315 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <yaml.h>
+
+#include "compile_commands.h"
+
+/* Free the memory allocated by "command", but not "command" itself.
+ */
+static void compile_command_clear(struct compile_command *command)
+{
+	int i;
+
+	free(command->directory);
+	free(command->file);
+	for (i = 0; i < command->argc; ++i)
+		free(command->argv[i]);
+	free(command->argv);
+}
+
+void compile_commands_free(struct compile_commands *commands)
+{
+	int i;
+
+	if (!commands)
+		return;
+
+	for (i = 0; i < commands->n; ++i)
+		compile_command_clear(&commands->command[i]);
+	free(commands->command);
+	free(commands);
+}
+
+/* Append a copy of the "len" characters starting at "arg"
+ * to the arguments of "command".
+ */
+static int add_arg(struct compile_command *command, const char *arg,
+	size_t len)
+{
+	char **argv;
+
+	argv = realloc(command->argv, (command->argc + 1) * sizeof(char *));
+	if (!argv)
+		return -1;
+	command->argv = argv;
+	argv[command->argc] = malloc(len + 1);
+	if (!argv[command->argc])
+		return -1;
+	memcpy(argv[command->argc], arg, len);
+	argv[command->argc][len] = '\0';
+	command->argc++;
+
+	return 0;
+}
+
+/* Split the shell command line "line" into arguments and
+ * append them to those of "command".
+ * Arguments are separated by whitespace.  Single quotes preserve
+ * everything up to the next single quote, while a backslash
+ * escapes the next character outside of single quotes.
+ * Within double quotes, a backslash only escapes
+ * a double quote or another backslash.
+ */
+static int split_command(struct compile_command *command, const char *line)
+{
+	size_t len = strlen(line);
+	char *arg;
+	int r = 0;
+
+	arg = malloc(len + 1);
+	if (!arg)
+		return -1;
+
+	while (r >= 0 && *line) {
+		size_t n = 0;
+
+		while (*line == ' ' || *line == '\t' || *line == '\n')
+			++line;
+		if (!*line)
+			break;
+		while (*line && *line != ' ' && *line != '\t' &&
+		    *line != '\n') {
+			if (*line == '\'') {
+				for (++line; *line && *line != '\''; ++line)
+					arg[n++] = *line;
+				if (*line)
+					++line;
+			} else if (*line == '"') {
+				for (++line; *line && *line != '"'; ++line) {
+					if (line[0] == '\\' &&
+					    (line[1] == '"' || line[1] == '\\'))
+						++line;
+					arg[n++] = *line;
+				}
+				if (*line)
+					++line;
+			} else if (*line == '\\' && line[1]) {
+				arg[n++] = line[1];
+				line += 2;
+			} else
+				arg[n++] = *line++;
+		}
+		r = add_arg(command, arg, n);
+	}
+
+	free(arg);
+	return r;
+}
+
+/* Return a copy of the string in "node", or NULL if "node"
+ * is not a scalar node.
+ */
+static char *extract_string(isl_ctx *ctx, yaml_node_t *node)
+{
+	if (node->type != YAML_SCALAR_NODE)
+		isl_die(ctx, isl_error_invalid, "expecting scalar node",
+			return NULL);
+
+	return strdup((char *) node->data.scalar.value);
+}
+
+/* Extract the arguments in the sequence "node" and
+ * append them to those of "command".
+ */
+static int extract_arguments(isl_ctx *ctx, yaml_document_t *document,
+	yaml_node_t *node, struct compile_command *command)
+{
+	yaml_node_item_t *item;
+
+	if (node->type != YAML_SEQUENCE_NODE)
+		isl_die(ctx, isl_error_invalid, "expecting sequence",
+			return -1);
+
+	for (item = node->data.sequence.items.start;
+	     item < node->data.sequence.items.top; ++item) {
+		yaml_node_t *n;
+
+		n = yaml_document_get_node(document, *item);
+		if (n->type != YAML_SCALAR_NODE)
+			isl_die(ctx, isl_error_invalid,
+				"expecting scalar node", return -1);
+		if (add_arg(command, (char *) n->data.scalar.value,
+				n->data.scalar.length) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Extract a compilation database entry from the mapping "node"
+ * and store it in "command".
+ * The compiler command line is taken from the "arguments" field
+ * if there is one and from the "command" field otherwise.
+ * Any other fields, such as "output", are ignored.
+ */
+static int extract_command(isl_ctx *ctx, yaml_document_t *document,
+	yaml_node_t *node, struct compile_command *command)
+{
+	yaml_node_pair_t *pair;
+	char *line = NULL;
+	int r = 0;
+
+	if (node->type != YAML_MAPPING_NODE)
+		isl_die(ctx, isl_error_invalid, "expecting mapping",
+			return -1);
+
+	for (pair = node->data.mapping.pairs.start;
+	     r >= 0 && pair < node->data.mapping.pairs.top; ++pair) {
+		yaml_node_t *key, *value;
+		const char *name;
+
+		key = yaml_document_get_node(document, pair->key);
+		value = yaml_document_get_node(document, pair->value);
+
+		if (key->type != YAML_SCALAR_NODE)
+			isl_die(ctx, isl_error_invalid, "expecting key",
+				free(line); return -1);
+
+		name = (char *) key->data.scalar.value;
+		if (!strcmp(name, "directory")) {
+			free(command->directory);
+			command->directory = extract_string(ctx, value);
+			if (!command->directory)
+				r = -1;
+		} else if (!strcmp(name, "file")) {
+			free(command->file);
+			command->file = extract_string(ctx, value);
+			if (!command->file)
+				r = -1;
+		} else if (!strcmp(name, "arguments")) {
+			r = extract_arguments(ctx, document, value, command);
+		} else if (!strcmp(name, "command")) {
+			free(line);
+			line = extract_string(ctx, value);
+			if (!line)
+				r = -1;
+		}
+	}
+
+	if (r >= 0 && command->argc == 0 && line)
+		r = split_command(command, line);
+	free(line);
+
+	if (r >= 0 && (!command->directory || !command->file ||
+			command->argc == 0))
+		isl_die(ctx, isl_error_invalid,
+			"incomplete compilation database entry", r = -1);
+
+	return r;
+}
+
+/* Extract the entries of the compilation database in the sequence "node".
+ */
+static struct compile_commands *extract_commands(isl_ctx *ctx,
+	yaml_document_t *document, yaml_node_t *node)
+{
+	struct compile_commands *commands;
+	yaml_node_item_t *item;
+	int n;
+
+	if (node->type != YAML_SEQUENCE_NODE)
+		isl_die(ctx, isl_error_invalid, "expecting sequence",
+			return NULL);
+
+	n = node->data.sequence.items.top - node->data.sequence.items.start;
+	commands = calloc(1, sizeof(*commands));
+	if (!commands)
+		return NULL;
+	commands->command = calloc(n ? n : 1, sizeof(*commands->command));
+	if (!commands->command)
+		goto error;
+
+	for (item = node->data.sequence.items.start;
+	     item < node->data.sequence.items.top; ++item) {
+		yaml_node_t *entry;
+
+		entry = yaml_document_get_node(document, *item);
+		commands->n++;
+		if (extract_command(ctx, document, entry,
+				&commands->command[commands->n - 1]) < 0)
+			goto error;
+	}
+
+	return commands;
+error:
+	compile_commands_free(commands);
+	return NULL;
+}
+
+/* Read a compilation database, i.e., the contents of
+ * a compile_commands.json file, from "in".
+ * Since JSON is essentially a subset of YAML, the file is parsed
+ * using the same YAML library as the one used for reading scops.
+ */
+struct compile_commands *compile_commands_read(isl_ctx *ctx, FILE *in)
+{
+	struct compile_commands *commands;
+	yaml_document_t document = { 0 };
+	yaml_parser_t parser = { 0 };
+	yaml_node_t *root;
+
+	if (!yaml_parser_initialize(&parser))
+		isl_die(ctx, isl_error_internal,
+			"unable to initialize parser", return NULL);
+	yaml_parser_set_input_file(&parser, in);
+
+	if (!yaml_parser_load(&parser, &document)) {
+		yaml_parser_delete(&parser);
+		isl_die(ctx, isl_error_invalid,
+			"unable to parse compilation database", return NULL);
+	}
+
+	root = yaml_document_get_root_node(&document);
+	if (!root) {
+		commands = calloc(1, sizeof(*commands));
+	} else
+		commands = extract_commands(ctx, &document, root);
+
+	yaml_document_delete(&document);
+	yaml_parser_delete(&parser);
+
+	return commands;
+}
@@ -34,6 +34,7 @@
  */
 
 #include <isl/aff.h>
+#include <isl/hash.h>
 
 #include "aff.h"
 #include "array.h"
@@ -375,6 +376,195 @@ int pet_context_allow_nesting(__isl_keep pet_context *pc)
 	return pc->allow_nested;
 }
 
+/* Internal data structure for pet_context_get_hash.
+ *
+ * "hash" collects the sum of the hash values of the assignments.
+ */
+struct pet_context_hash_data {
+	uint32_t hash;
+};
+
+/* Add a hash value that digests the assignment of "value" to "id"
+ * to data->hash.
+ * The hash values of the individual assignments are simply added up
+ * such that the result does not depend on the order in which
+ * the assignments are visited.
+ */
+static isl_stat add_assignment_hash(__isl_take isl_id *id,
+	__isl_take isl_pw_aff *value, void *user)
+{
+	struct pet_context_hash_data *data = user;
+	uint32_t hash, hash_f;
+
+	hash = isl_hash_init();
+	hash_f = isl_id_get_hash(id);
+	isl_hash_hash(hash, hash_f);
+	hash_f = isl_pw_aff_get_hash(value);
+	isl_hash_hash(hash, hash_f);
+	data->hash += hash;
+
+	isl_id_free(id);
+	isl_pw_aff_free(value);
+
+	return isl_stat_ok;
+}
+
+/* Return a hash value that digests "pc".
+ * Contexts that are equal according to pet_context_is_equal
+ * have the same hash value.
+ */
+uint32_t pet_context_get_hash(__isl_keep pet_context *pc)
+{
+	struct pet_context_hash_data data = { 0 };
+	uint32_t hash, hash_f;
+
+	if (!pc)
+		return 0;
+
+	hash = isl_hash_init();
+	hash_f = isl_set_get_hash(pc->domain);
+	isl_hash_hash(hash, hash_f);
+	isl_hash_byte(hash, pc->allow_nested & 0xFF);
+	if (isl_id_to_pw_aff_foreach(pc->assignments,
+					&add_assignment_hash, &data) < 0)
+		return 0;
+	isl_hash_hash(hash, data.hash);
+
+	return hash;
+}
+
+/* Internal data structure for pet_context_is_equal.
+ *
+ * "assignments" are the assignments of the second context.
+ * "n" is the number of assignments in the first context.
+ * "equal" is set to 0 as soon as an assignment is found
+ * that is not also present in the second context.
+ */
+struct pet_context_is_equal_data {
+	isl_id_to_pw_aff *assignments;
+	int n;
+	int equal;
+};
+
+/* Is the assignment of "value" to "id" also present in data->assignments?
+ * Only count the assignments if they are all present.
+ */
+static isl_stat is_known_assignment(__isl_take isl_id *id,
+	__isl_take isl_pw_aff *value, void *user)
+{
+	struct pet_context_is_equal_data *data = user;
+	isl_bool has;
+	isl_pw_aff *value2;
+	isl_bool equal;
+
+	data->n++;
+	has = isl_id_to_pw_aff_has(data->assignments, id);
+	if (has < 0 || !has) {
+		isl_id_free(id);
+		isl_pw_aff_free(value);
+		data->equal = has;
+		return isl_stat_error;
+	}
+
+	value2 = isl_id_to_pw_aff_get(data->assignments, id);
+	equal = isl_pw_aff_plain_is_equal(value, value2);
+	isl_pw_aff_free(value);
+	isl_pw_aff_free(value2);
+	if (equal < 0 || !equal) {
+		data->equal = equal;
+		return isl_stat_error;
+	}
+
+	return isl_stat_ok;
+}
+
+/* Count the number of assignments of a context.
+ */
+static isl_stat count_assignment(__isl_take isl_id *id,
+	__isl_take isl_pw_aff *value, void *user)
+{
+	int *n = user;
+
+	(*n)++;
+	isl_id_free(id);
+	isl_pw_aff_free(value);
+
+	return isl_stat_ok;
+}
+
+/* Do "set1" and "set2" have the same identifiers
+ * for their set dimensions?
+ * The sets are assumed to have the same number of set dimensions.
+ */
+static int has_equal_dim_ids(__isl_keep isl_set *set1,
+	__isl_keep isl_set *set2)
+{
+	int i, n;
+	int equal = 1;
+
+	n = isl_set_dim(set1, isl_dim_set);
+	for (i = 0; equal && i < n; ++i) {
+		isl_bool has1, has2;
+		isl_id *id1, *id2;
+
+		has1 = isl_set_has_dim_id(set1, isl_dim_set, i);
+		has2 = isl_set_has_dim_id(set2, isl_dim_set, i);
+		if (has1 < 0 || has2 < 0)
+			return -1;
+		if (has1 != has2)
+			return 0;
+		if (!has1)
+			continue;
+		id1 = isl_set_get_dim_id(set1, isl_dim_set, i);
+		id2 = isl_set_get_dim_id(set2, isl_dim_set, i);
+		equal = id1 == id2;
+		isl_id_free(id1);
+		isl_id_free(id2);
+	}
+
+	return equal;
+}
+
+/* Are "pc1" and "pc2" obviously equal?
+ * That is, do they have the same domain (with the same identifiers
+ * for the loop iterators), the same assignments and
+ * the same value of allow_nested?
+ * The cache of extracted affine expressions is ignored.
+ */
+int pet_context_is_equal(__isl_keep pet_context *pc1,
+	__isl_keep pet_context *pc2)
+{
+	struct pet_context_is_equal_data data;
+	int n2 = 0;
+	int equal;
+
+	if (!pc1 || !pc2)
+		return -1;
+	if (pc1 == pc2)
+		return 1;
+
+	if (pc1->allow_nested != pc2->allow_nested)
+		return 0;
+	equal = isl_set_plain_is_equal(pc1->domain, pc2->domain);
+	if (equal < 0 || !equal)
+		return equal;
+	equal = has_equal_dim_ids(pc1->domain, pc2->domain);
+	if (equal < 0 || !equal)
+		return equal;
+
+	data.assignments = pc2->assignments;
+	data.n = 0;
+	data.equal = 1;
+	if (isl_id_to_pw_aff_foreach(pc1->assignments,
+					&is_known_assignment, &data) < 0)
+		return data.equal == 1 ? -1 : data.equal;
+	if (isl_id_to_pw_aff_foreach(pc2->assignments,
+					&count_assignment, &n2) < 0)
+		return -1;
+
+	return data.n == n2;
+}
+
 /* Allow affine expressions created in this context to involve
  * parameters that encode a pet_expr based on the value of "allow_nested".
  */
@@ -27,6 +27,9 @@ __isl_give pet_context *pet_context_clear_value(__isl_keep pet_context *pc,
 __isl_give pet_context *pet_context_set_allow_nested(__isl_take pet_context *pc,
 	int allow_nested);
 int pet_context_allow_nesting(__isl_keep pet_context *pc);
+uint32_t pet_context_get_hash(__isl_keep pet_context *pc);
+int pet_context_is_equal(__isl_keep pet_context *pc1,
+	__isl_keep pet_context *pc2);
 
 __isl_give pet_context *pet_context_clear_writes_in_expr(
 	__isl_take pet_context *pc, __isl_keep pet_expr *expr);
@@ -44,6 +44,31 @@ int pet_options_get_encapsulate_dynamic_control(isl_ctx *ctx);
 int pet_options_set_signed_overflow(isl_ctx *ctx, int val);
 int pet_options_get_signed_overflow(isl_ctx *ctx);
 
+/* If pch is set, then the precompiled header with that name
+ * is implicitly included before the input file.
+ * The precompiled header needs to have been generated by
+ * the same version of clang as the one pet is linked against.
+ */
+int pet_options_set_pch(isl_ctx *ctx, const char *pch);
+const char *pet_options_get_pch(isl_ctx *ctx);
+
+/* If summaries is set, then the summaries of functions that are
+ * called from the input, but that are defined in other translation units,
+ * are read from the summary database in that directory.
+ * If write_summaries is also set, then the summaries of
+ * all functions defined in the input are stored in the database.
+ */
+int pet_options_set_summaries(isl_ctx *ctx, const char *dir);
+const char *pet_options_get_summaries(isl_ctx *ctx);
+int pet_options_set_write_summaries(isl_ctx *ctx, int val);
+int pet_options_get_write_summaries(isl_ctx *ctx);
+
+/* If memoize is set, then the result of extracting a loop-free
+ * piece of code is reused for identical code in the same context.
+ */
+int pet_options_set_memoize(isl_ctx *ctx, int val);
+int pet_options_get_memoize(isl_ctx *ctx);
+
 struct pet_loc;
 typedef struct pet_loc pet_loc;
 
@@ -545,9 +570,120 @@ int pet_op_is_inc_dec(enum pet_op_type op);
 /* Extract a pet_scop from a C source file.
  * If function is not NULL, then the pet_scop is extracted from
  * a function with that name.
+ *
+ * This function, as well as pet_transform_C_source and
+ * the pet_session functions, may be called concurrently from
+ * several threads, provided each thread uses its own isl_ctx.
  */
 __isl_give pet_scop *pet_scop_extract_from_C_source(isl_ctx *ctx,
 	const char *filename, const char *function);
+/* Extract a pet_scop from the C source code in the "len" bytes
+ * of "buffer", in the same way as pet_scop_extract_from_C_source.
+ * "name" is the name under which the code is presented in diagnostics.
+ */
+__isl_give pet_scop *pet_scop_extract_from_C_buffer(isl_ctx *ctx,
+	const char *name, const char *buffer, size_t len,
+	const char *function);
+
+struct pet_session;
+typedef struct pet_session pet_session;
+
+/* Allocate a session for extracting pet_scops in "ctx".
+ * A session caches the parts of the parser setup that do not depend
+ * on the input file such that they can be reused across extractions.
+ * The input files are assumed not to change during the lifetime
+ * of the session.
+ */
+__isl_give pet_session *pet_session_alloc(isl_ctx *ctx);
+__isl_null pet_session *pet_session_free(__isl_take pet_session *session);
+isl_ctx *pet_session_get_ctx(__isl_keep pet_session *session);
+/* Use a cache of pet_scops in "session".
+ * Before extracting a pet_scop, "lookup" is called with a key
+ * that is a hash of everything that may affect the pet_scop.
+ * If it returns a pet_scop, then this pet_scop is used instead.
+ * Otherwise, the extracted pet_scop is passed to "store"
+ * along with the same key.
+ */
+isl_stat pet_session_set_scop_cache(__isl_keep pet_session *session,
+	__isl_give pet_scop *(*lookup)(isl_ctx *ctx, const char *key,
+		void *user),
+	isl_stat (*store)(const char *key, __isl_keep pet_scop *scop,
+		void *user),
+	void *user);
+
+struct pet_stats;
+typedef struct pet_stats pet_stats;
+
+/* Statistics about the time spent in the different phases
+ * of extractions, per function, along with the numbers of
+ * extracted statements, arrays and implications.
+ * A pet_stats object should only be used from a single thread.
+ * pet_stats_start and pet_stats_stop can be used to time
+ * additional (nested) phases, e.g., the writing out of the pet_scops.
+ * pet_stats_print prints the statistics in human readable form or,
+ * if "json" is set, as a single line JSON object.
+ */
+__isl_give pet_stats *pet_stats_alloc(isl_ctx *ctx);
+__isl_null pet_stats *pet_stats_free(__isl_take pet_stats *stats);
+isl_stat pet_stats_reset(__isl_keep pet_stats *stats);
+isl_stat pet_stats_start(__isl_keep pet_stats *stats, const char *phase);
+isl_stat pet_stats_stop(__isl_keep pet_stats *stats);
+isl_stat pet_stats_print(__isl_keep pet_stats *stats, FILE *out, int json);
+/* Write a trace event in the JSON array format of the Chrome trace event
+ * format to "out" for each phase and for each of the (nested) steps
+ * of the construction of the pet_scops, annotated with the corresponding
+ * line in the input.  The opening bracket of the array is not written.
+ */
+isl_stat pet_stats_set_trace(__isl_keep pet_stats *stats, FILE *out);
+/* Collect statistics about subsequent extractions in "session"
+ * in "stats", which needs to outlive the session.
+ * If "stats" is NULL, then no statistics are collected.
+ */
+isl_stat pet_session_set_stats(__isl_keep pet_session *session,
+	__isl_keep pet_stats *stats);
+
+/* If "incremental" is set, then keep the pet_scops extracted from
+ * each input in "session" and reuse them when the same input is extracted
+ * again, e.g., after an edit of a buffer passed to
+ * pet_session_extract_buffer, for all functions that have not changed
+ * (other than by moving within the input).
+ */
+isl_stat pet_session_set_incremental(__isl_keep pet_session *session,
+	int incremental);
+
+/* Only extract pet_scops from part "part" (counting from 0)
+ * of "n_part" parts of the functions that contain scops.
+ * The functions are assigned to the parts in a round-robin fashion,
+ * such that the extractions of the different parts can be run
+ * concurrently, in separate sessions, to obtain all pet_scops.
+ */
+isl_stat pet_session_set_partition(__isl_keep pet_session *session,
+	int n_part, int part);
+
+/* Extract a pet_scop from each function in the C source file "filename"
+ * (or only from the function called "function" if it is not NULL)
+ * and pass it to "fn".
+ */
+isl_stat pet_session_extract(__isl_keep pet_session *session,
+	const char *filename, const char *function,
+	isl_stat (*fn)(__isl_take pet_scop *scop, void *user), void *user);
+/* Extract a pet_scop from each function in the C source file "filename"
+ * as it would be compiled by the compiler command line
+ * in the "argc" elements of "argv", executed in "directory",
+ * e.g., as specified by an entry of a compilation database.
+ */
+isl_stat pet_session_extract_with_command(__isl_keep pet_session *session,
+	const char *directory, const char *filename,
+	int argc, const char **argv, const char *function,
+	isl_stat (*fn)(__isl_take pet_scop *scop, void *user), void *user);
+/* Extract a pet_scop from each function in the C source code
+ * in the "len" bytes of "buffer" and pass it to "fn".
+ * "name" is the name under which the code is presented in diagnostics.
+ */
+isl_stat pet_session_extract_buffer(__isl_keep pet_session *session,
+	const char *name, const char *buffer, size_t len,
+	const char *function,
+	isl_stat (*fn)(__isl_take pet_scop *scop, void *user), void *user);
 
 /* Transform the C source file "input" by rewriting each scop
  * When autodetecting scops, at most one scop per function is rewritten.
@@ -556,6 +692,15 @@ __isl_give pet_scop *pet_scop_extract_from_C_source(isl_ctx *ctx,
 int pet_transform_C_source(isl_ctx *ctx, const char *input, FILE *output,
 	__isl_give isl_printer *(*transform)(__isl_take isl_printer *p,
 		__isl_take pet_scop *scop, void *user), void *user);
+/* Transform the C source code in the "len" bytes of "buffer"
+ * in the same way as pet_transform_C_source and
+ * return the transformed C code.
+ * "name" is the name under which the code is presented in diagnostics.
+ */
+__isl_give char *pet_transform_C_buffer(isl_ctx *ctx, const char *name,
+	const char *buffer, size_t len,
+	__isl_give isl_printer *(*transform)(__isl_take isl_printer *p,
+		__isl_take pet_scop *scop, void *user), void *user);
 /* Given a scop and a printer passed to a pet_transform_C_source callback,
  * print the original corresponding code to the printer.
  */
@@ -0,0 +1,63 @@
+#!/bin/sh
+# Check that the time spent on extracting a scop with many inlined calls
+# grows linearly with the number of calls.
+# The input is a scaled up version of tests/inline12.c.
+# Each inlined call requires fresh names for the arguments
+# of the inlined function.  If finding a fresh name took time
+# proportional to the number of earlier calls, then multiplying
+# the number of calls by four would multiply the extraction time
+# by sixteen.  The script fails if the extraction time grows
+# by more than the given factor instead.
+#
+# usage: inline_bench.sh [number of calls] [maximal factor] [path to pet]
+
+n=${1:-1000}
+max=${2:-8}
+pet=${3:-./pet}
+file=${TMPDIR:-/tmp}/inline_bench_$$.c
+log=${TMPDIR:-/tmp}/inline_bench_$$.log
+
+# Write out a function with "$1" inlined calls to "file".
+generate()
+{
+	{
+		echo "inline int select(int n, int a[n], int i)"
+		echo "{"
+		echo "	return a[i];"
+		echo "}"
+		echo
+		echo "void foo(int n, int a[n], int b[n])"
+		echo "{"
+		echo "#pragma scop"
+		echo "	for (int i = 0; i < n; ++i) {"
+		i=0
+		while [ $i -lt $1 ]; do
+			echo "		b[i] += select(n, a, i);"
+			i=$((i + 1))
+		done
+		echo "	}"
+		echo "#pragma endscop"
+		echo "}"
+	} > $file
+}
+
+# Print the CPU time spent in the extract phase on a file
+# with "$1" inlined calls.
+extract_time()
+{
+	generate $1
+	$pet --stats $file > /dev/null 2> $log || return
+	awk '$1 == "extract" { print $3 }' $log
+}
+
+small=$(extract_time $n) && large=$(extract_time $((4 * n)))
+r=$?
+rm -f $file $log
+test $r -eq 0 || exit $r
+
+echo "$n calls: $small s, $((4 * n)) calls: $large s"
+awk -v small=$small -v large=$large -v max=$max \
+	'BEGIN { exit !(large <= max * small) }' || {
+	echo "extraction time grows by more than a factor $max" >&2
+	exit 1
+}
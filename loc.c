@@ -235,3 +235,26 @@ error:
 	free(indent);
 	return pet_loc_free(loc);
 }
+
+/* Move the region of "loc" by "offset" bytes and "line" lines,
+ * e.g., because the code it refers to has moved in the input.
+ *
+ * pet_loc_dummy does not refer to any region and is returned unchanged,
+ * as is the line number if it is not known.
+ */
+__isl_give pet_loc *pet_loc_shift(__isl_take pet_loc *loc, int offset,
+	int line)
+{
+	if (loc == &pet_loc_dummy)
+		return loc;
+	loc = pet_loc_cow(loc);
+	if (!loc)
+		return NULL;
+
+	loc->start += offset;
+	loc->end += offset;
+	if (loc->line >= 0)
+		loc->line += line;
+
+	return loc;
+}
@@ -19,6 +19,8 @@ __isl_give pet_loc *pet_loc_update_start_end_from_loc(__isl_take pet_loc *loc,
 	__isl_keep pet_loc *loc2);
 __isl_give pet_loc *pet_loc_set_indent(__isl_take pet_loc *loc,
 	__isl_take char *indent);
+__isl_give pet_loc *pet_loc_shift(__isl_take pet_loc *loc, int offset,
+	int line);
 
 #if defined(__cplusplus)
 }
@@ -104,11 +104,15 @@ AC_EGREP_HEADER([void HandleTopLevelDecl\(], [clang/AST/ASTConsumer.h],
 	[AC_DEFINE([HandleTopLevelDeclReturn], [void],
 		   [Return type of HandleTopLevelDeclReturn])
 	 AC_DEFINE([HandleTopLevelDeclContinue], [],
-		   [Return type of HandleTopLevelDeclReturn])],
+		   [Return type of HandleTopLevelDeclReturn])
+	 AC_DEFINE([HandleTopLevelDeclAbort], [],
+		   [Return value of HandleTopLevelDecl for stopping parsing])],
 	[AC_DEFINE([HandleTopLevelDeclReturn], [bool],
 		   [Return type of HandleTopLevelDeclReturn])
 	 AC_DEFINE([HandleTopLevelDeclContinue], [true],
-		   [Return type of HandleTopLevelDeclReturn])])
+		   [Return type of HandleTopLevelDeclReturn])
+	 AC_DEFINE([HandleTopLevelDeclAbort], [false],
+		   [Return value of HandleTopLevelDecl for stopping parsing])])
 AC_CHECK_HEADER([clang/Basic/DiagnosticOptions.h],
 	[AC_DEFINE([HAVE_BASIC_DIAGNOSTICOPTIONS_H], [],
 		   [Define if clang/Basic/DiagnosticOptions.h exists])])
@@ -170,6 +174,18 @@ AC_EGREP_HEADER([DecayedType], [clang/AST/Type.h],
 AC_EGREP_HEADER([setMainFileID], [clang/Basic/SourceManager.h],
 	[AC_DEFINE([HAVE_SETMAINFILEID], [],
 	[Define if SourceManager has a setMainFileID method])])
+AC_TRY_COMPILE([#include <clang/Basic/SourceManager.h>], [
+	using namespace clang;
+	SourceManager *SM;
+	std::unique_ptr<llvm::MemoryBuffer> buffer;
+	SM->createFileID(std::move(buffer));
+], [AC_DEFINE([CREATEFILEID_TAKES_UNIQUE_PTR], [],
+	[Define if SourceManager::createFileID takes a std::unique_ptr])])
+AC_TRY_COMPILE([#include <clang/Frontend/CompilerInstance.h>], [
+	using namespace clang;
+	DisableValidationForModuleKind kind = DisableValidationForModuleKind::None;
+], [AC_DEFINE([HAVE_DISABLEVALIDATIONFORMODULEKIND], [],
+	[Define if DisableValidationForModuleKind is available])])
 AC_CHECK_HEADER([llvm/ADT/OwningPtr.h],
 	[AC_DEFINE([HAVE_ADT_OWNINGPTR_H], [],
 		   [Define if llvm/ADT/OwningPtr.h exists])])
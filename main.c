@@ -31,45 +31,513 @@
  * Leiden University.
  */ 
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <isl/arg.h>
 #include <isl/ctx.h>
 #include <isl/options.h>
 
+#include "batch.h"
+#include "compile_commands.h"
 #include "options.h"
 #include "scop.h"
+#include "scop_cache.h"
 #include "scop_yaml.h"
 
 struct options {
 	struct isl_options	*isl;
 	struct pet_options	*pet;
 	char			*input;
+	char			*batch;
+	char			*compile_commands;
+	int			jobs;
+	char			*cache_dir;
+	int			cache_stats;
+	int			stats;
+	char			*trace;
+};
+
+#define STATS_NONE	0
+#define STATS_TABLE	1
+#define STATS_JSON	2
+
+static struct isl_arg_choice stats_format[] = {
+	{"none",	STATS_NONE},
+	{"table",	STATS_TABLE},
+	{"json",	STATS_JSON},
+	{0}
 };
 
 ISL_ARGS_START(struct options, options_args)
 ISL_ARG_CHILD(struct options, isl, "isl", &isl_options_args, "isl options")
 ISL_ARG_CHILD(struct options, pet, NULL, &pet_options_args, "pet options")
 ISL_ARG_ARG(struct options, input, "input", NULL)
+ISL_ARG_STR(struct options, batch, 0, "batch", "file", NULL,
+	"extract scops from each input file listed in \"file\"")
+ISL_ARG_STR(struct options, compile_commands, 0, "compile-commands", "file",
+	NULL, "extract scops from each translation unit in "
+	"the compilation database \"file\"")
+ISL_ARG_INT(struct options, jobs, 'j', "jobs", "n", 1,
+	"number of parallel workers in batch mode")
+ISL_ARG_STR(struct options, cache_dir, 0, "cache-dir", "dir", NULL,
+	"reuse scops extracted by earlier runs from the cache in \"dir\"")
+ISL_ARG_BOOL(struct options, cache_stats, 0, "cache-stats", 0,
+	"print statistics about the use of the scop cache")
+ISL_ARG_OPT_CHOICE(struct options, stats, 0, "stats", stats_format,
+	STATS_NONE, STATS_TABLE, "print timing and other statistics "
+	"of the extraction on standard error")
+ISL_ARG_STR(struct options, trace, 0, "trace", "file", NULL,
+	"write a trace of the extraction to \"file\" in Chrome "
+	"trace event format")
 ISL_ARGS_END
 
 ISL_ARG_DEF(options, struct options, options_args)
 
+/* The statistics collected during extraction, if any,
+ * along with the format in which they should be reported.
+ */
+struct extract_stats {
+	pet_stats *stats;
+	int format;
+};
+
+/* A list of input files along with the files to which
+ * the corresponding scops should be written.
+ */
+struct batch_list {
+	pet_session *session;
+	struct extract_stats *stats;
+	int n;
+	int size;
+	char **input;
+	char **output;
+};
+
+/* Free all memory allocated by "list".
+ */
+static void batch_list_clear(struct batch_list *list)
+{
+	int i;
+
+	for (i = 0; i < list->n; ++i) {
+		free(list->input[i]);
+		free(list->output[i]);
+	}
+	free(list->input);
+	free(list->output);
+}
+
+/* Add an input file "input" to "list", with corresponding output file
+ * "output".  If "output" is NULL, then the output is written to
+ * a file with the same name as "input", but with ".scop" appended.
+ */
+static int batch_list_add(struct batch_list *list, const char *input,
+	const char *output)
+{
+	if (list->n >= list->size) {
+		int size = 2 * list->size + 16;
+		char **p;
+
+		p = realloc(list->input, size * sizeof(char *));
+		if (!p)
+			return -1;
+		list->input = p;
+		p = realloc(list->output, size * sizeof(char *));
+		if (!p)
+			return -1;
+		list->output = p;
+		list->size = size;
+	}
+
+	list->input[list->n] = strdup(input);
+	if (output) {
+		list->output[list->n] = strdup(output);
+	} else {
+		list->output[list->n] = malloc(strlen(input) + sizeof(".scop"));
+		if (list->output[list->n])
+			sprintf(list->output[list->n], "%s.scop", input);
+	}
+	list->n++;
+	if (!list->input[list->n - 1] || !list->output[list->n - 1])
+		return -1;
+
+	return 0;
+}
+
+/* Read a list of input files from "filename", one per line.
+ * Each input file may be followed by the name of the output file
+ * for the scop extracted from that input file.
+ * Empty lines are ignored.
+ */
+static int batch_list_read(struct batch_list *list, const char *filename)
+{
+	FILE *file;
+	char line[4096];
+	int r = 0;
+
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "unable to open %s\n", filename);
+		return -1;
+	}
+
+	while (r >= 0 && fgets(line, sizeof(line), file)) {
+		char *input, *output;
+
+		input = strtok(line, " \t\r\n");
+		if (!input)
+			continue;
+		output = strtok(NULL, " \t\r\n");
+		r = batch_list_add(list, input, output);
+	}
+
+	fclose(file);
+	return r;
+}
+
+/* Allocate a session for extracting scops in "ctx",
+ * using the scop cache "cache", if it is not NULL, and
+ * collecting statistics in "stats", if they are being collected.
+ */
+static pet_session *alloc_session(isl_ctx *ctx, struct scop_cache *cache,
+	struct extract_stats *stats)
+{
+	pet_session *session;
+
+	session = pet_session_alloc(ctx);
+	if (session && cache &&
+	    pet_session_set_scop_cache(session, &scop_cache_lookup,
+					&scop_cache_store, cache) < 0)
+		session = pet_session_free(session);
+	if (session && stats->stats &&
+	    pet_session_set_stats(session, stats->stats) < 0)
+		session = pet_session_free(session);
+
+	return session;
+}
+
+/* Write "scop" to "out", attributing the time spent
+ * to the "emit" phase in "stats", if they are being collected.
+ */
+static int emit(FILE *out, struct pet_scop *scop, struct extract_stats *stats)
+{
+	int r;
+
+	if (stats->stats)
+		pet_stats_start(stats->stats, "emit");
+	r = pet_scop_emit(out, scop);
+	if (stats->stats)
+		pet_stats_stop(stats->stats);
+
+	return r;
+}
+
+/* Print the statistics in "stats", if any and if requested,
+ * on standard error and reset them.
+ * In batch mode, this is called after each input file.
+ * The report is first written to a temporary file such that
+ * it can be written out in one go, without getting mixed up
+ * with the reports of other workers.
+ */
+static int print_stats(struct extract_stats *stats)
+{
+	FILE *tmp;
+	char buf[4096];
+	size_t n;
+	int r = 0;
+
+	if (!stats->stats)
+		return 0;
+	if (stats->format == STATS_NONE)
+		return pet_stats_reset(stats->stats) < 0 ? -1 : 0;
+	tmp = tmpfile();
+	if (!tmp)
+		return -1;
+	if (pet_stats_print(stats->stats, tmp,
+				stats->format == STATS_JSON) < 0)
+		r = -1;
+	rewind(tmp);
+	while ((n = fread(buf, 1, sizeof(buf), tmp)) > 0)
+		fwrite(buf, 1, n, stderr);
+	fclose(tmp);
+	if (pet_stats_reset(stats->stats) < 0)
+		r = -1;
+
+	return r;
+}
+
+/* Store "scop" into the address pointed to by "user", unless
+ * a scop has already been stored there.
+ * Return isl_stat_error to indicate that we are not interested
+ * in any further scops.
+ */
+static isl_stat set_first_scop(__isl_take pet_scop *scop, void *user)
+{
+	pet_scop **p = user;
+
+	if (!*p)
+		*p = scop;
+	else
+		pet_scop_free(scop);
+
+	return isl_stat_error;
+}
+
+/* Extract a scop from input file "i" of the batch_list "user"
+ * and write it to the corresponding output file.
+ * As in the single input case, no scop is written if none was found,
+ * but the output file is still created to indicate that
+ * the input file was processed.
+ */
+static int extract_batch_item(int i, void *user)
+{
+	struct batch_list *list = user;
+	struct pet_scop *scop = NULL;
+	FILE *out;
+	int r = 0;
+
+	out = fopen(list->output[i], "w");
+	if (!out) {
+		fprintf(stderr, "unable to open %s\n", list->output[i]);
+		return -1;
+	}
+
+	pet_session_extract(list->session, list->input[i], NULL,
+				&set_first_scop, &scop);
+	if (scop && emit(out, scop, list->stats) < 0)
+		r = -1;
+	pet_scop_free(scop);
+
+	if (fclose(out) != 0)
+		r = -1;
+	if (print_stats(list->stats) < 0)
+		r = -1;
+
+	return r;
+}
+
+/* Extract scops from each of the input files listed in "filename",
+ * using "n_job" parallel workers and scop cache "cache" (if not NULL),
+ * collecting statistics in "stats".
+ * The parser setup is shared by all extractions performed
+ * by the same worker.
+ */
+static int extract_batch(isl_ctx *ctx, const char *filename, int n_job,
+	struct scop_cache *cache, struct extract_stats *stats)
+{
+	struct batch_list list = { NULL };
+	int r;
+
+	list.stats = stats;
+	list.session = alloc_session(ctx, cache, stats);
+	if (!list.session)
+		return 1;
+	r = batch_list_read(&list, filename);
+	if (r >= 0)
+		r = batch_foreach(list.n, n_job, &extract_batch_item, &list);
+	batch_list_clear(&list);
+	pet_session_free(list.session);
+
+	return r < 0 ? 1 : 0;
+}
+
+/* The entries of a compilation database along with
+ * the session in which they are processed.
+ */
+struct compile_commands_data {
+	pet_session *session;
+	struct extract_stats *stats;
+	struct compile_commands *commands;
+};
+
+/* Extract a scop from the translation unit described by entry "i"
+ * of the compilation database in "user" and write it to a file
+ * with the same name as the main source file of the translation unit,
+ * but with ".scop" appended.
+ * As in batch mode, the output file is created even if no scop was found.
+ */
+static int extract_compile_command(int i, void *user)
+{
+	struct compile_commands_data *data = user;
+	struct compile_command *command = &data->commands->command[i];
+	struct pet_scop *scop = NULL;
+	char *output;
+	FILE *out;
+	int r = 0;
+
+	output = malloc(strlen(command->directory) + strlen(command->file) +
+			sizeof("/.scop"));
+	if (!output)
+		return -1;
+	if (command->file[0] == '/')
+		sprintf(output, "%s.scop", command->file);
+	else
+		sprintf(output, "%s/%s.scop", command->directory,
+			command->file);
+
+	out = fopen(output, "w");
+	if (!out) {
+		fprintf(stderr, "unable to open %s\n", output);
+		free(output);
+		return -1;
+	}
+	free(output);
+
+	pet_session_extract_with_command(data->session, command->directory,
+		command->file, command->argc, (const char **) command->argv,
+		NULL, &set_first_scop, &scop);
+	if (scop && emit(out, scop, data->stats) < 0)
+		r = -1;
+	pet_scop_free(scop);
+
+	if (fclose(out) != 0)
+		r = -1;
+	if (print_stats(data->stats) < 0)
+		r = -1;
+
+	return r;
+}
+
+/* Extract scops from each translation unit in the compilation database
+ * "filename", using "n_job" parallel workers and
+ * scop cache "cache" (if not NULL), collecting statistics in "stats".
+ */
+static int extract_compile_commands(isl_ctx *ctx, const char *filename,
+	int n_job, struct scop_cache *cache, struct extract_stats *stats)
+{
+	struct compile_commands_data data;
+	FILE *in;
+	int r;
+
+	in = fopen(filename, "r");
+	if (!in) {
+		fprintf(stderr, "unable to open %s\n", filename);
+		return 1;
+	}
+	data.commands = compile_commands_read(ctx, in);
+	fclose(in);
+	if (!data.commands)
+		return 1;
+
+	data.stats = stats;
+	data.session = alloc_session(ctx, cache, stats);
+	if (!data.session)
+		r = -1;
+	else
+		r = batch_foreach(data.commands->n, n_job,
+				&extract_compile_command, &data);
+	pet_session_free(data.session);
+	compile_commands_free(data.commands);
+
+	return r < 0 ? 1 : 0;
+}
+
+/* Extract a scop from "input" and print it on standard output,
+ * using scop cache "cache" (if not NULL) and
+ * collecting statistics in "stats".
+ */
+static int extract_single(isl_ctx *ctx, const char *input,
+	struct scop_cache *cache, struct extract_stats *stats)
+{
+	pet_session *session;
+	struct pet_scop *scop = NULL;
+
+	session = alloc_session(ctx, cache, stats);
+	if (!session)
+		return 1;
+	pet_session_extract(session, input, NULL, &set_first_scop, &scop);
+	pet_session_free(session);
+
+	if (scop)
+		emit(stdout, scop, stats);
+
+	pet_scop_free(scop);
+
+	return print_stats(stats) < 0 ? 1 : 0;
+}
+
+/* Open "filename" for writing trace events and
+ * write the opening bracket of the array of events.
+ * The file is line buffered such that each event is written out
+ * as a whole, also when trace events are written to the same file
+ * by several batch workers.
+ */
+static FILE *open_trace(const char *filename)
+{
+	FILE *trace;
+
+	trace = fopen(filename, "w");
+	if (!trace) {
+		fprintf(stderr, "unable to open %s\n", filename);
+		return NULL;
+	}
+	setvbuf(trace, NULL, _IOLBF, 0);
+	fprintf(trace, "[\n");
+	return trace;
+}
+
+/* Close the trace file "trace", terminating the array of events
+ * with a metadata event naming the process such that
+ * the result is also valid JSON.
+ */
+static int close_trace(FILE *trace)
+{
+	if (!trace)
+		return 0;
+	fprintf(trace, "{\"name\":\"process_name\",\"ph\":\"M\","
+		"\"pid\":%d,\"args\":{\"name\":\"pet\"}}\n]\n", (int) getpid());
+	return fclose(trace) != 0 ? -1 : 0;
+}
+
 int main(int argc, char *argv[])
 {
 	isl_ctx *ctx;
-	struct pet_scop *scop;
 	struct options *options;
+	struct scop_cache *cache = NULL;
+	struct extract_stats stats = { NULL, STATS_NONE };
+	FILE *trace = NULL;
+	int r = 0;
 
 	options = options_new_with_defaults();
 	ctx = isl_ctx_alloc_with_options(&options_args, options);
 	argc = options_parse(options, argc, argv, ISL_ARG_ALL);
 
-	scop = pet_scop_extract_from_C_source(ctx, options->input, NULL);
+	if (options->cache_dir) {
+		cache = scop_cache_alloc(options->cache_dir);
+		if (!cache) {
+			fprintf(stderr, "unable to set up scop cache\n");
+			isl_ctx_free(ctx);
+			return 1;
+		}
+	}
 
-	if (scop)
-		pet_scop_emit(stdout, scop);
+	stats.format = options->stats;
+	if (stats.format != STATS_NONE || options->trace)
+		stats.stats = pet_stats_alloc(ctx);
+	if (options->trace) {
+		trace = open_trace(options->trace);
+		if (!trace || pet_stats_set_trace(stats.stats, trace) < 0)
+			r = 1;
+	}
 
-	pet_scop_free(scop);
+	if (r == 0 && options->batch)
+		r = extract_batch(ctx, options->batch, options->jobs, cache,
+					&stats);
+	else if (r == 0 && options->compile_commands)
+		r = extract_compile_commands(ctx, options->compile_commands,
+						options->jobs, cache, &stats);
+	else if (r == 0)
+		r = extract_single(ctx, options->input, cache, &stats);
+
+	if (cache && options->cache_stats)
+		scop_cache_print_stats(stderr, cache);
+	scop_cache_free(cache);
+	pet_stats_free(stats.stats);
+	if (close_trace(trace) < 0)
+		r = 1;
 
 	isl_ctx_free(ctx);
-	return 0;
+	return r;
 }
@@ -58,6 +58,20 @@ ISL_ARG_STR_LIST(struct pet_options, n_path, paths, 'I', "include-path",
 	"path", NULL)
 ISL_ARG_STR_LIST(struct pet_options, n_define, defines, 'D', NULL,
 	"macro[=defn]", NULL)
+ISL_ARG_STR(struct pet_options, pch, 0, "pch", "file", NULL,
+	"precompiled header to include before the input")
+ISL_ARG_STR(struct pet_options, summaries, 0, "summaries", "dir", NULL,
+	"directory of function summaries for functions defined elsewhere")
+ISL_ARG_BOOL(struct pet_options, write_summaries, 0, "write-summaries", 0,
+	"store summaries of all functions defined in the input "
+	"in the summaries directory")
+ISL_ARG_ULONG(struct pet_options, max_operations, 0, "max-operations", 0,
+	"maximal number of isl operations per function, after which "
+	"the function is extracted again with dynamic control "
+	"encapsulated (0 for no limit)")
+ISL_ARG_BOOL(struct pet_options, memoize, 0, "memoize", 0,
+	"reuse the result of extracting loop-free code "
+	"for identical code in the same context")
 ISL_ARG_VERSION(&pet_print_version)
 ISL_ARGS_END
 
@@ -84,6 +98,24 @@ ISL_CTX_SET_CHOICE_DEF(pet_options, struct pet_options, pet_options_args,
 ISL_CTX_GET_CHOICE_DEF(pet_options, struct pet_options, pet_options_args,
 	signed_overflow)
 
+ISL_CTX_SET_STR_DEF(pet_options, struct pet_options, pet_options_args, pch)
+ISL_CTX_GET_STR_DEF(pet_options, struct pet_options, pet_options_args, pch)
+
+ISL_CTX_SET_STR_DEF(pet_options, struct pet_options, pet_options_args,
+	summaries)
+ISL_CTX_GET_STR_DEF(pet_options, struct pet_options, pet_options_args,
+	summaries)
+
+ISL_CTX_SET_BOOL_DEF(pet_options, struct pet_options, pet_options_args,
+	write_summaries)
+ISL_CTX_GET_BOOL_DEF(pet_options, struct pet_options, pet_options_args,
+	write_summaries)
+
+ISL_CTX_SET_BOOL_DEF(pet_options, struct pet_options, pet_options_args,
+	memoize)
+ISL_CTX_GET_BOOL_DEF(pet_options, struct pet_options, pet_options_args,
+	memoize)
+
 /* Create an isl_ctx that references the pet options.
  */
 isl_ctx *isl_ctx_alloc_with_pet_options()
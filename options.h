@@ -23,6 +23,26 @@ struct pet_options {
 	const char **paths;
 	int	n_define;
 	const char **defines;
+	/* If not NULL, the precompiled header that provides the part
+	 * of the input that is included before the main file.
+	 */
+	char	*pch;
+	/* If not NULL, the directory containing the summary database
+	 * from which summaries of functions without a body are read.
+	 */
+	char	*summaries;
+	/* If set, then the summaries of all functions with a body
+	 * (with external linkage) are stored in the summary database.
+	 */
+	int	write_summaries;
+	/* If not zero, the maximal number of isl operations that
+	 * may be performed while extracting the scops of a function.
+	 */
+	unsigned long	max_operations;
+	/* If set, then the pet_scops extracted from loop-free subtrees
+	 * are reused for identical subtrees in the same context.
+	 */
+	int	memoize;
 
 	unsigned signed_overflow;
 };
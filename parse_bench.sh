@@ -0,0 +1,71 @@
+#!/bin/sh
+# Check that parsing stops once the first scop has been extracted.
+# The script generates a large file with many functions that
+# do not contain a scop, along with a single function that does.
+# The time spent in the parse phase, as reported by --stats,
+# is measured once with the scop at the top of the file and
+# once with the scop at the bottom.  The script fails if the first
+# is not smaller than the second by at least the given factor.
+# If parsing continued to the end of the file, then the two
+# would be about the same.
+#
+# usage: parse_bench.sh [number of functions] [minimal factor] [path to pet]
+
+n=${1:-5000}
+min=${2:-4}
+pet=${3:-./pet}
+tmp=${TMPDIR:-/tmp}/parse_bench_$$
+file=$tmp.c
+
+scop()
+{
+	echo "void scop(int n, int a[n])"
+	echo "{"
+	echo "#pragma scop"
+	echo "	for (int i = 0; i < n; ++i)"
+	echo "		a[i] = i;"
+	echo "#pragma endscop"
+	echo "}"
+}
+
+filler()
+{
+	i=0
+	while [ $i -lt $n ]; do
+		echo "int f$i(int n, int *a)"
+		echo "{"
+		echo "	int s = 0;"
+		echo "	for (int i = 0; i < n; ++i)"
+		echo "		s += a[i] * $i;"
+		echo "	return s;"
+		echo "}"
+		i=$((i + 1))
+	done
+}
+
+# Print the CPU time spent in the parse phase on "file",
+# after checking that a scop was extracted.
+parse_time()
+{
+	$pet --stats $file > $tmp.scop 2> $tmp.log || return
+	grep '^statements:' $tmp.scop > /dev/null || return
+	awk '$1 == "parse" { print $3 }' $tmp.log
+}
+
+{ scop; filler; } > $file
+top=$(parse_time)
+r=$?
+if [ $r -eq 0 ]; then
+	{ filler; scop; } > $file
+	bottom=$(parse_time)
+	r=$?
+fi
+rm -f $file $tmp.scop $tmp.log
+test $r -eq 0 || exit $r
+
+echo "$n functions: scop at top $top s, scop at bottom $bottom s"
+awk -v top=$top -v bottom=$bottom -v min=$min \
+	'BEGIN { exit !(min * top <= bottom) }' || {
+	echo "parsing does not stop after the scop" >&2
+	exit 1
+}
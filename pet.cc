@@ -35,8 +35,10 @@
 #include "config.h"
 #undef PACKAGE
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <map>
+#include <mutex>
 #include <vector>
 #include <iostream>
 #ifdef HAVE_ADT_OWNINGPTR_H
@@ -47,8 +49,8 @@
 #ifdef HAVE_LLVM_OPTION_ARG_H
 #include <llvm/Option/Arg.h>
 #endif
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
 #include <llvm/Support/raw_ostream.h>
-#include <llvm/Support/ManagedStatic.h>
 #include <llvm/Support/Host.h>
 #include <clang/Basic/Version.h>
 #include <clang/Basic/Builtins.h>
@@ -85,6 +87,7 @@
 #include <clang/Frontend/FrontendOptions.h>
 #include <clang/Frontend/Utils.h>
 #include <clang/Lex/HeaderSearch.h>
+#include <clang/Lex/Lexer.h>
 #include <clang/Lex/Preprocessor.h>
 #include <clang/Lex/Pragma.h>
 #include <clang/AST/ASTContext.h>
@@ -95,6 +98,7 @@
 #include <clang/Parse/ParseAST.h>
 
 #include <isl/ctx.h>
+#include <isl/options.h>
 #include <isl/constraint.h>
 
 #include <pet.h>
@@ -104,6 +108,9 @@
 #include "options.h"
 #include "scan.h"
 #include "print.h"
+#include "scop_key.h"
+#include "stats.h"
+#include "version.h"
 
 #define ARRAY_SIZE(array) (sizeof(array)/sizeof(*array))
 
@@ -556,6 +563,68 @@ static void update_arrays(struct pet_scop *scop,
 	isl_union_map_free(value_bounds);
 }
 
+/* A cache of extracted pet_scops, as set by pet_session_set_scop_cache.
+ * "lookup" is NULL if no cache is being used.
+ */
+struct ScopCache {
+	pet_scop *(*lookup)(isl_ctx *ctx, const char *key, void *user);
+	isl_stat (*store)(const char *key, pet_scop *scop, void *user);
+	void *user;
+
+	ScopCache() : lookup(NULL), store(NULL), user(NULL) {}
+};
+
+/* A pet_scop extracted in incremental mode, or NULL if no pet_scop
+ * was extracted, along with the offset and line number of the start
+ * of the function definition from which it was extracted.
+ */
+struct IncrementalScop {
+	pet_scop *scop;
+	unsigned offset;
+	unsigned line;
+};
+
+/* The pet_scops extracted from one version of an input in incremental mode,
+ * indexed by a key that describes everything that may affect them,
+ * with the positions described relative to the start of the function
+ * from which they were extracted.
+ * The pet_scops are owned by this object.
+ */
+struct IncrementalScops {
+	std::map<std::string, IncrementalScop> scops;
+
+	IncrementalScops() {}
+	~IncrementalScops() {
+		clear();
+	}
+
+	void clear() {
+		std::map<std::string, IncrementalScop>::iterator it;
+
+		for (it = scops.begin(); it != scops.end(); ++it)
+			pet_scop_free(it->second.scop);
+		scops.clear();
+	}
+	void swap(IncrementalScops &other) {
+		scops.swap(other.scops);
+	}
+	/* Add "scop" to the collection under key "key",
+	 * replacing any previous element with the same key.
+	 */
+	void add(const std::string &key, pet_scop *scop, unsigned offset,
+		unsigned line) {
+		IncrementalScop &entry = scops[key];
+
+		pet_scop_free(entry.scop);
+		entry.scop = scop;
+		entry.offset = offset;
+		entry.line = line;
+	}
+private:
+	IncrementalScops(const IncrementalScops &);
+	IncrementalScops &operator=(const IncrementalScops &);
+};
+
 /* Extract a pet_scop (if any) from each appropriate function.
  * Each detected scop is passed to "fn".
  * When autodetecting, at most one scop is extracted from each function.
@@ -578,9 +647,36 @@ struct PetASTConsumer : public ASTConsumer {
 	isl_set *context_value;
 	set<ValueDecl *> live_out;
 	PragmaValueBoundsHandler *vb_handler;
+	/* Caches shared by all PetScan objects on this translation unit. */
+	PetScanCache scan_cache;
 	isl_stat (*fn)(struct pet_scop *scop, void *user);
 	void *user;
 	bool error;
+	/* Has the function called "function" (if any) been handled? */
+	bool function_done;
+	/* If last_scop_known is set, then no scop or endscop pragmas
+	 * appear in the main file beyond offset last_scop_end.
+	 */
+	bool last_scop_known;
+	unsigned last_scop_end;
+	/* The cache of extracted scops, if any. */
+	const ScopCache *cache;
+	/* Only scops from candidate functions with a sequence number
+	 * equal to "part" modulo "n_part" are extracted.
+	 * "n_candidate" is the number of candidates encountered so far.
+	 */
+	int n_part;
+	int part;
+	int n_candidate;
+	/* The statistics collected during the extraction, if any. */
+	pet_stats *stats;
+	/* In incremental mode, "previous" contains the pet_scops extracted
+	 * from the previous version of the input and "current" collects
+	 * those of the current version.
+	 * Both are NULL if not in incremental mode.
+	 */
+	const IncrementalScops *previous;
+	IncrementalScops *current;
 
 	PetASTConsumer(isl_ctx *ctx, Preprocessor &PP, ASTContext &ast_context,
 		DiagnosticsEngine &diags, ScopLocList &scops,
@@ -589,7 +685,10 @@ struct PetASTConsumer : public ASTConsumer {
 		PP(PP), ast_context(ast_context), diags(diags),
 		scops(scops), function(function), options(options),
 		ctx(ctx),
-		vb_handler(NULL), fn(fn), user(user), error(false)
+		vb_handler(NULL), fn(fn), user(user), error(false),
+		function_done(false), last_scop_known(false), last_scop_end(0),
+		cache(NULL), n_part(1), part(0), n_candidate(0), stats(NULL),
+		previous(NULL), current(NULL)
 	{
 		isl_space *space;
 		space = isl_space_params_alloc(ctx, 0);
@@ -629,11 +728,16 @@ struct PetASTConsumer : public ASTConsumer {
 	 * In particular, add the context and value_bounds constraints
 	 * speficied through pragmas, add reference identifiers and
 	 * reset user pointers on parameters and tuple ids.
+	 * If "key" is not empty, then the result is also stored
+	 * in the scop cache under that key.
+	 * Similarly, the result is kept for the next version of the input
+	 * in incremental mode under "incremental_key", if it is not empty.
 	 *
 	 * If "scop" does not contain any statements and autodetect
 	 * is turned on, then skip it.
 	 */
-	void call_fn(pet_scop *scop) {
+	void call_fn(FunctionDecl *fd, pet_scop *scop, const std::string &key,
+		const std::string &incremental_key) {
 		if (!scop) {
 			error = true;
 			return;
@@ -644,87 +748,493 @@ struct PetASTConsumer : public ASTConsumer {
 			return;
 		}
 		if (options->autodetect && scop->n_stmt == 0) {
+			remember(fd, incremental_key, NULL);
 			pet_scop_free(scop);
 			return;
 		}
-		scop->context = isl_set_intersect(scop->context,
+		{
+			pet_stats_phase phase(stats, "postprocess");
+			scop->context = isl_set_intersect(scop->context,
 						isl_set_copy(context));
-		scop->context_value = isl_set_intersect(scop->context_value,
+			scop->context_value = isl_set_intersect(
+						scop->context_value,
 						isl_set_copy(context_value));
 
-		update_arrays(scop, get_value_bounds(), live_out);
+			update_arrays(scop, get_value_bounds(), live_out);
 
-		scop = pet_scop_add_ref_ids(scop);
-		scop = pet_scop_anonymize(scop);
+			scop = pet_scop_add_ref_ids(scop);
+			scop = pet_scop_anonymize(scop);
+		}
 
+		if (scop && !key.empty() && cache->store) {
+			pet_stats_phase phase(stats, "cache");
+			cache->store(key.c_str(), scop, cache->user);
+		}
+		remember(fd, incremental_key, scop);
+		pet_stats_add_scop(stats, scop);
 		if (fn(scop, user) < 0)
 			error = true;
 	}
 
-	/* For each explicitly marked scop (using pragmas),
-	 * extract the scop and call "fn" on it if it is inside "fd".
+	/* Pass "scop", which has already been postprocessed, to "fn",
+	 * unless an error has occurred.
 	 */
-	void scan_scops(FunctionDecl *fd) {
-		unsigned start, end;
-		vector<ScopLoc>::iterator it;
-		isl_union_map *vb = vb_handler->value_bounds;
-		SourceManager &SM = PP.getSourceManager();
+	void call_fn_on_cached(pet_scop *scop) {
+		pet_stats_add_scop(stats, scop);
+		if (diags.hasErrorOccurred()) {
+			error = true;
+			pet_scop_free(scop);
+		} else if (fn(scop, user) < 0)
+			error = true;
+	}
+
+	/* In incremental mode, keep a copy of "scop", extracted from "fd",
+	 * for the next version of the input under key "key",
+	 * along with the position of "fd".
+	 * "scop" may be NULL to indicate that no scop was extracted.
+	 */
+	void remember(FunctionDecl *fd, const std::string &key,
+		pet_scop *scop) {
+		unsigned offset, line;
+		pet_scop *copy;
+
+		if (!current || key.empty())
+			return;
+		copy = pet_scop_dup(scop);
+		if (scop && !copy)
+			return;
+		pet_scop_key_position(PP.getSourceManager(), fd, offset, line);
+		current->add(key, copy, offset, line);
+	}
+
+	/* In incremental mode, look for the result of the extraction
+	 * of the scop with key "key" from "fd" in the previous version
+	 * of the input and, if it is found, pass it on to "fn" and
+	 * return true.
+	 * Since "fd" may have moved with respect to the previous version,
+	 * the locations in the scop are moved accordingly.
+	 */
+	bool reuse(FunctionDecl *fd, const std::string &key) {
+		std::map<std::string, IncrementalScop>::const_iterator it;
+		unsigned offset, line;
 		pet_scop *scop;
 
-		if (scops.list.size() == 0)
+		it = previous->scops.find(key);
+		if (it == previous->scops.end())
+			return false;
+		scop = pet_scop_dup(it->second.scop);
+		pet_scop_key_position(PP.getSourceManager(), fd, offset, line);
+		scop = pet_scop_shift_loc(scop,
+				(int) offset - (int) it->second.offset,
+				(int) line - (int) it->second.line);
+		if (it->second.scop && !scop)
+			return false;
+		remember(fd, key, scop);
+		if (scop)
+			call_fn_on_cached(scop);
+		return true;
+	}
+
+	/* Construct the key of the scop cache entry for the scop
+	 * delimited by "loc" in "fd".
+	 * The key is a hash of all the information that may affect
+	 * the extracted scop: the versions of pet and clang,
+	 * the options, the target, the position of the scop,
+	 * the information collected from pragmas and a description
+	 * of "fd" along with all the declarations it depends on,
+	 * including any summaries read from the summary database.
+	 * In autodetect mode, "loc" is not used.
+	 * If "relative" is set, then all positions are described
+	 * relative to the start of "fd", such that the key remains
+	 * the same if "fd" (along with the functions it calls)
+	 * moves in the input.
+	 */
+	std::string cache_key(FunctionDecl *fd, const ScopLoc &loc,
+		bool relative) {
+		std::string s;
+		llvm::raw_string_ostream os(s);
+		set<std::string> names;
+		set<ValueDecl *>::iterator it;
+		set<std::string>::iterator it_name;
+		pet_scop_key key(PP.getSourceManager(), options->summaries, os);
+		long offset, line;
+		char *str;
+
+		if (relative)
+			pet_scop_key_position(PP.getSourceManager(), fd,
+					key.origin_offset, key.origin_line);
+		offset = key.origin_offset;
+		line = key.origin_line;
+
+		os << pet_version_id() << "\n";
+		os << getClangFullVersion() << "\n";
+		os << ast_context.getTargetInfo().getTriple().str() << "\n";
+		os << options->autodetect << " "
+		   << options->detect_conditional_assignment << " "
+		   << options->encapsulate_dynamic_control << " "
+		   << options->pencil << " " << options->signed_overflow << " "
+		   << options->max_operations << "\n";
+		if (!options->autodetect)
+			os << loc.start - offset << " " << loc.end - offset
+			   << " " << loc.start_line - line << "\n";
+		for (size_t i = 0; i < independent.size(); ++i)
+			os << independent[i].line - line << " ";
+		os << "\n";
+		str = isl_set_to_str(context);
+		os << str << "\n";
+		free(str);
+		str = isl_set_to_str(context_value);
+		os << str << "\n";
+		free(str);
+		str = isl_union_map_to_str(vb_handler->value_bounds);
+		os << str << "\n";
+		free(str);
+		for (it = live_out.begin(); it != live_out.end(); ++it)
+			names.insert((*it)->getNameAsString());
+		for (it_name = names.begin(); it_name != names.end(); ++it_name)
+			os << *it_name << " ";
+		os << "\n";
+		key.describe(fd);
+		os.flush();
+
+		return pet_scop_key_hash(s);
+	}
+
+	/* Extract the scop delimited by "loc" from "fd".
+	 */
+	pet_scop *scan(FunctionDecl *fd, ScopLoc &loc) {
+		PetScan ps(PP, ast_context, fd, loc, options,
+			    isl_union_map_copy(vb_handler->value_bounds),
+			    independent, scan_cache);
+		ps.stats = stats;
+		pet_stats_phase phase(stats, "extract");
+		return ps.scan(fd);
+	}
+
+	/* Report that the isl operation budget was exceeded
+	 * while extracting a scop from "fd" and
+	 * what is being done about it in "action".
+	 */
+	void report_budget_exceeded(FunctionDecl *fd, const char *action) {
+		unsigned id;
+		std::string msg = "isl operation budget exceeded; ";
+
+		msg += action;
+		id = diags.getCustomDiagID(DiagnosticsEngine::Warning, "%0");
+		diags.Report(begin_loc(fd), id) << msg;
+	}
+
+	/* Handle the last isl error that occurred while isl errors
+	 * were being ignored in the way prescribed by "on_error",
+	 * i.e., the on_error setting that was in effect before.
+	 * That is, print the error, unless "on_error" says
+	 * errors should be ignored, and abort if "on_error" says so.
+	 */
+	void handle_isl_error(int on_error) {
+		const char *msg, *file;
+
+		if (on_error == ISL_ON_ERROR_CONTINUE)
 			return;
+		msg = isl_ctx_last_error_msg(ctx);
+		file = isl_ctx_last_error_file(ctx);
+		fprintf(stderr, "%s:%d: %s\n", file ? file : "isl",
+			isl_ctx_last_error_line(ctx), msg ? msg : "error");
+		if (on_error == ISL_ON_ERROR_ABORT)
+			abort();
+	}
+
+	/* Perform a scan of "fd" for the scop delimited by "loc"
+	 * within a budget of options->max_operations isl operations.
+	 * Return true if the budget was not exceeded.
+	 * Any result obtained in an attempt that exceeds the budget
+	 * is discarded.
+	 * Any other isl error is handled according to "on_error",
+	 * the on_error setting outside of the attempt.
+	 */
+	bool scan_within_budget(FunctionDecl *fd, ScopLoc &loc,
+		pet_scop *&scop, int on_error) {
+		enum isl_error error;
+
+		isl_ctx_reset_error(ctx);
+		isl_ctx_reset_operations(ctx);
+		scop = scan(fd, loc);
+		error = isl_ctx_last_error(ctx);
+		if (error != isl_error_quota) {
+			if (error != isl_error_none)
+				handle_isl_error(on_error);
+			return true;
+		}
+		scop = pet_scop_free(scop);
+		isl_ctx_reset_error(ctx);
+		return false;
+	}
+
+	/* Extract the scop delimited by "loc" from "fd",
+	 * bounding the number of isl operations by options->max_operations,
+	 * if it is set.
+	 * If the budget is exceeded, then the scop is extracted again
+	 * with dynamic control encapsulated in macro statements,
+	 * which avoids the construction of skip conditions and
+	 * implications that typically cause the blowup.
+	 * If the budget is also exceeded in this second attempt
+	 * (or if dynamic control was already being encapsulated),
+	 * then no scop is extracted from "fd" and "exceeded" is set.
+	 * Both fallbacks are reported as warnings.
+	 * The function summaries extracted during the second attempt
+	 * are kept apart from the regular ones since they are coarser.
+	 * isl errors are not printed while an attempt is running since
+	 * the errors signaling that the budget was exceeded
+	 * are expected.  Any other error is handled after the attempt
+	 * according to the on_error setting of "ctx", which is restored
+	 * before returning.
+	 */
+	pet_scop *scan_with_budget(FunctionDecl *fd, ScopLoc &loc,
+		bool &exceeded) {
+		pet_scop *scop;
+		int on_error;
+		unsigned long max_operations;
+		int encapsulate = options->encapsulate_dynamic_control;
+		bool done;
+
+		exceeded = false;
+		if (!options->max_operations)
+			return scan(fd, loc);
+
+		on_error = isl_options_get_on_error(ctx);
+		max_operations = isl_ctx_get_max_operations(ctx);
+		isl_options_set_on_error(ctx, ISL_ON_ERROR_CONTINUE);
+		isl_ctx_set_max_operations(ctx, options->max_operations);
+
+		done = scan_within_budget(fd, loc, scop, on_error);
+		if (!done && !encapsulate) {
+			report_budget_exceeded(fd,
+				"encapsulating dynamic control");
+			options->encapsulate_dynamic_control = 1;
+			scan_cache.fallback = true;
+			done = scan_within_budget(fd, loc, scop, on_error);
+			scan_cache.fallback = false;
+			options->encapsulate_dynamic_control = encapsulate;
+		}
+		if (!done) {
+			report_budget_exceeded(fd, "skipping function");
+			exceeded = true;
+		}
 
+		isl_ctx_set_max_operations(ctx, max_operations);
+		isl_options_set_on_error(ctx, on_error);
+		return scop;
+	}
+
+	/* Extract the scop delimited by "loc" from "fd" and
+	 * call "fn" on it.
+	 * In autodetect mode, "loc" is not used and it is not
+	 * considered an error if no scop can be extracted.
+	 * Neither is it considered an error if no scop could be
+	 * extracted within the isl operation budget.
+	 *
+	 * In incremental mode, first look for the scop
+	 * in the previous version of the input.
+	 * If a scop cache is being used, then next look for
+	 * the scop in the cache and, if it is found there,
+	 * pass it to "fn" without further processing,
+	 * since the cached scop has already been postprocessed.
+	 */
+	void extract_scop(FunctionDecl *fd, ScopLoc &loc) {
+		std::string key, incremental_key;
+		pet_scop *scop;
+		bool exceeded;
+
+		if (current) {
+			pet_stats_phase phase(stats, "cache");
+			incremental_key = cache_key(fd, loc, true);
+			if (reuse(fd, incremental_key))
+				return;
+		}
+		if (cache && cache->lookup) {
+			pet_stats_phase phase(stats, "cache");
+			key = cache_key(fd, loc, false);
+			scop = cache->lookup(ctx, key.c_str(), cache->user);
+		} else
+			scop = NULL;
+		if (scop) {
+			remember(fd, incremental_key, scop);
+			call_fn_on_cached(scop);
+			return;
+		}
+
+		scop = scan_with_budget(fd, loc, exceeded);
+		if ((options->autodetect || exceeded) && !scop) {
+			remember(fd, incremental_key, NULL);
+			return;
+		}
+		call_fn(fd, scop, key, incremental_key);
+	}
+
+	/* Does the explicitly marked scop "loc" overlap with "fd"?
+	 */
+	bool overlaps(FunctionDecl *fd, const ScopLoc &loc) {
+		unsigned start, end;
+		SourceManager &SM = PP.getSourceManager();
+
+		if (!loc.end)
+			return false;
 		start = SM.getFileOffset(begin_loc(fd));
 		end = SM.getFileOffset(end_loc(fd));
+		return start <= loc.end && end >= loc.start;
+	}
+
+	/* Is "fd" a candidate for scop extraction?
+	 * In autodetect mode, every function definition is a candidate.
+	 * Otherwise, only those that overlap with an explicitly
+	 * marked scop are.
+	 */
+	bool is_candidate(FunctionDecl *fd) {
+		vector<ScopLoc>::iterator it;
+
+		if (options->autodetect)
+			return true;
+		for (it = scops.list.begin(); it != scops.list.end(); ++it)
+			if (overlaps(fd, *it))
+				return true;
+		return false;
+	}
+
+	/* Should the scops in candidate function "fd" be extracted
+	 * given the selected part of the candidates?
+	 * The candidates are numbered in the order in which they
+	 * appear in the input, such that the same numbering
+	 * is obtained in each extraction from the same input.
+	 */
+	bool in_part(FunctionDecl *fd) {
+		if (n_part == 1)
+			return true;
+		if (!is_candidate(fd))
+			return false;
+		return n_candidate++ % n_part == part;
+	}
+
+	/* For each explicitly marked scop (using pragmas),
+	 * extract the scop and call "fn" on it if it is inside "fd".
+	 */
+	void scan_scops(FunctionDecl *fd) {
+		vector<ScopLoc>::iterator it;
 
 		for (it = scops.list.begin(); it != scops.list.end(); ++it) {
 			ScopLoc loc = *it;
-			if (!loc.end)
-				continue;
-			if (start > loc.end)
+			if (!overlaps(fd, loc))
 				continue;
-			if (end < loc.start)
-				continue;
-			PetScan ps(PP, ast_context, fd, loc, options,
-				    isl_union_map_copy(vb), independent);
-			scop = ps.scan(fd);
-			call_fn(scop);
+			extract_scop(fd, loc);
+		}
+	}
+
+	/* Store the summary of "fd" in the summary database.
+	 */
+	void store_summary(FunctionDecl *fd) {
+		pet_stats_phase phase(stats, "summaries");
+		ScopLoc loc;
+		PetScan ps(PP, ast_context, fd, loc, options,
+			    isl_union_map_copy(vb_handler->value_bounds),
+			    independent, scan_cache);
+		ps.store_summary(fd);
+	}
+
+	/* Extract scops from the function definition "fd".
+	 * If "write" is set, then also store its summary
+	 * in the summary database.
+	 */
+	void handle_function(FunctionDecl *fd, bool write) {
+		if (write)
+			store_summary(fd);
+		if (error)
+			return;
+		if (function &&
+		    fd->getNameInfo().getAsString() != function)
+			return;
+		if (function)
+			function_done = true;
+		if (!in_part(fd))
+			return;
+		if (options->autodetect) {
+			ScopLoc loc;
+			extract_scop(fd, loc);
+			return;
 		}
+		scan_scops(fd);
 	}
 
+	/* Extract scops from the function definitions in "dg".
+	 * If summaries are being written to the summary database,
+	 * then also store the summaries of all these functions.
+	 * Any statistics are attributed to the function
+	 * that is being handled.
+	 *
+	 * If an error has occurred, or if "fn" has indicated that
+	 * it is not interested in any further scops, then
+	 * the remainder of the input is of no further interest and
+	 * the parser is told to stop, on those versions of clang
+	 * that allow HandleTopLevelDecl to abort parsing.
+	 * If summaries are being written, then the remainder of the input
+	 * is still of interest.
+	 */
 	virtual HandleTopLevelDeclReturn HandleTopLevelDecl(DeclGroupRef dg) {
 		DeclGroupRef::iterator it;
+		bool write = options->summaries && options->write_summaries;
 
-		if (error)
-			return HandleTopLevelDeclContinue;
+		if (error && !write)
+			return HandleTopLevelDeclAbort;
 
 		for (it = dg.begin(); it != dg.end(); ++it) {
-			isl_union_map *vb = vb_handler->value_bounds;
 			FunctionDecl *fd = dyn_cast<clang::FunctionDecl>(*it);
 			if (!fd)
 				continue;
 			if (!fd->hasBody())
 				continue;
-			if (function &&
-			    fd->getNameInfo().getAsString() != function)
-				continue;
-			if (options->autodetect) {
-				ScopLoc loc;
-				pet_scop *scop;
-				PetScan ps(PP, ast_context, fd, loc, options,
-					    isl_union_map_copy(vb),
-					    independent);
-				scop = ps.scan(fd);
-				if (!scop)
-					continue;
-				call_fn(scop);
-				continue;
-			}
-			scan_scops(fd);
+			pet_stats_set_function(stats,
+					fd->getNameInfo().getAsString());
+			handle_function(fd, write);
+			pet_stats_set_function(stats, "");
 		}
 
+		if (error && !write)
+			return HandleTopLevelDeclAbort;
 		return HandleTopLevelDeclContinue;
 	}
+
+	/* Does "decl" start in the main file after the last
+	 * scop or endscop pragma, as determined by prescan_scop_pragmas?
+	 * This can only be determined if scops are delimited by pragmas.
+	 */
+	bool after_last_scop(Decl *decl) {
+		SourceManager &SM = PP.getSourceManager();
+		SourceLocation loc;
+
+		if (options->autodetect || !last_scop_known)
+			return false;
+		loc = SM.getExpansionLoc(begin_loc(decl));
+		if (SM.getFileID(loc) != SM.getMainFileID())
+			return false;
+		return SM.getFileOffset(loc) > last_scop_end;
+	}
+
+	/* Can the body of "decl" be skipped by the parser?
+	 *
+	 * The body of a function is not only needed when a scop
+	 * is extracted from the function itself, but also when
+	 * a summary is extracted from it or when it is inlined
+	 * into a function that appears later in the input.
+	 * The bodies of functions that appear after the one called
+	 * "function" (if any) are therefore not needed once
+	 * that function has been handled.
+	 * Similarly, the bodies of functions that appear after
+	 * the last scop pragma are not needed.
+	 * The declarations themselves are kept in any case.
+	 * If summaries are being written, then all bodies are needed.
+	 */
+	virtual bool shouldSkipFunctionBody(Decl *decl) {
+		if (options->summaries && options->write_summaries)
+			return false;
+		return function_done || after_last_scop(decl);
+	}
 };
 
 static const char *ResourceDir =
@@ -754,6 +1264,12 @@ static bool is_implicit(const IdentifierInfo *ident, int pencil)
 	return false;
 }
 
+/* Serializes the printing of diagnostics, which all end up
+ * on the same (unsynchronized) llvm::errs() stream,
+ * from concurrent extractions.
+ */
+static std::mutex diagnostics_mutex;
+
 /* Ignore implicit function declaration warnings on
  * "min", "max", "ceild" and "floord" as we detect and handle these
  * in PetScan.
@@ -785,8 +1301,10 @@ struct MyDiagnosticPrinter : public TextDiagnosticPrinter {
 		    info.getArgKind(0) == DiagnosticsEngine::ak_identifierinfo &&
 		    is_implicit(info.getArgIdentifier(0), pencil))
 			/* ignore warning */;
-		else
+		else {
+			std::lock_guard<std::mutex> lock(diagnostics_mutex);
 			TextDiagnosticPrinter::HandleDiagnostic(level, info);
+		}
 	}
 };
 
@@ -854,40 +1372,62 @@ static void create_from_args(CompilerInvocation &invocation,
 
 #endif
 
-/* Create a CompilerInvocation object that stores the command line
- * arguments constructed by the driver.
+/* Construct the command line arguments for the clang frontend
+ * that the driver would use when called with arguments "driver_args"
+ * (not including the name of the binary) and store them in "args".
  * The arguments are mainly useful for setting up the system include
  * paths on newer clangs and on some platforms.
+ * Return true if the arguments could be constructed.
  */
-static CompilerInvocation *construct_invocation(const char *filename,
-	DiagnosticsEngine &Diags)
+static bool construct_cc1_args(const std::vector<const char *> &driver_args,
+	DiagnosticsEngine &Diags, std::vector<std::string> &args)
 {
 	const char *binary = CLANG_PREFIX"/bin/clang";
 	const unique_ptr<Driver> driver(construct_driver(binary, Diags));
 	std::vector<const char *> Argv;
 	Argv.push_back(binary);
-	Argv.push_back(filename);
+	Argv.insert(Argv.end(), driver_args.begin(), driver_args.end());
 	const unique_ptr<Compilation> compilation(
 		driver->BuildCompilation(llvm::ArrayRef<const char *>(Argv)));
 	JobList &Jobs = compilation->getJobs();
 	if (Jobs.size() < 1)
-		return NULL;
+		return false;
 
 	Command *cmd = cast<Command>(ClangAPI::command(*Jobs.begin()));
 	if (strcmp(cmd->getCreator().getName(), "clang"))
-		return NULL;
+		return false;
+
+	const ArgStringList &cmd_args = cmd->getArguments();
+	args.assign(cmd_args.begin(), cmd_args.end());
+	return true;
+}
+
+/* Create a CompilerInvocation object that stores the command line
+ * arguments "args" constructed by construct_cc1_args.
+ */
+static CompilerInvocation *construct_invocation(
+	const std::vector<std::string> &args, DiagnosticsEngine &Diags)
+{
+	ArgStringList arg_list;
 
-	const ArgStringList *args = &cmd->getArguments();
+	for (size_t i = 0; i < args.size(); ++i)
+		arg_list.push_back(args[i].c_str());
 
 	CompilerInvocation *invocation = new CompilerInvocation;
-	create_from_args(*invocation, args, Diags);
+	create_from_args(*invocation, &arg_list, Diags);
 	return invocation;
 }
 
 #else
 
-static CompilerInvocation *construct_invocation(const char *filename,
-	DiagnosticsEngine &Diags)
+static bool construct_cc1_args(const std::vector<const char *> &driver_args,
+	DiagnosticsEngine &Diags, std::vector<std::string> &args)
+{
+	return false;
+}
+
+static CompilerInvocation *construct_invocation(
+	const std::vector<std::string> &args, DiagnosticsEngine &Diags)
 {
 	return NULL;
 }
@@ -1009,6 +1549,60 @@ static void create_main_file_id(SourceManager &SM, const FileEntry *file)
 
 #endif
 
+#ifdef CREATEFILEID_TAKES_UNIQUE_PTR
+
+/* Create a main file called "name" with contents "buf" of length "len".
+ * The contents are copied such that the caller is free
+ * to reuse "buf" after this function returns.
+ */
+static void create_main_file_id(SourceManager &SM, const char *name,
+	const char *buf, size_t len)
+{
+	std::unique_ptr<llvm::MemoryBuffer> buffer(
+		llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(buf, len),
+							name));
+	SM.setMainFileID(SM.createFileID(std::move(buffer)));
+}
+
+#else
+
+/* Create a main file called "name" with contents "buf" of length "len".
+ * The contents are copied such that the caller is free
+ * to reuse "buf" after this function returns.
+ */
+static void create_main_file_id(SourceManager &SM, const char *name,
+	const char *buf, size_t len)
+{
+	SM.createMainFileIDForMemBuffer(
+		llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(buf, len),
+							name));
+}
+
+#endif
+
+#ifdef HAVE_DISABLEVALIDATIONFORMODULEKIND
+
+/* Load the precompiled header "pch" as an external AST source.
+ */
+static void create_pch_external_ast_source(CompilerInstance *Clang,
+	const char *pch)
+{
+	Clang->createPCHExternalASTSource(pch,
+		DisableValidationForModuleKind::None, false, NULL, false);
+}
+
+#else
+
+/* Load the precompiled header "pch" as an external AST source.
+ */
+static void create_pch_external_ast_source(CompilerInstance *Clang,
+	const char *pch)
+{
+	Clang->createPCHExternalASTSource(pch, false, false, NULL, false);
+}
+
+#endif
+
 #ifdef SETLANGDEFAULTS_TAKES_5_ARGUMENTS
 
 #include "set_lang_defaults_arg4.h"
@@ -1089,6 +1683,81 @@ static const FileEntry *getFile(CompilerInstance *Clang, std::string Filename)
 	return ignore_error(Clang->getFileManager().getFile(Filename));
 }
 
+/* Is "tok" a raw identifier spelled "name"?
+ */
+static bool is_raw_identifier(SourceManager &SM, const LangOptions &LO,
+	const Token &tok, const char *name)
+{
+	if (tok.isNot(tok::raw_identifier))
+		return false;
+	if (tok.needsCleaning())
+		return Lexer::getSpelling(tok, SM, LO) == name;
+	return llvm::StringRef(SM.getCharacterData(tok.getLocation()),
+				tok.getLength()) == name;
+}
+
+/* Scan the main file of "SM" for scop and endscop pragmas
+ * using a raw lexer, i.e., without running the preprocessor.
+ * Return false if the main file certainly does not contain
+ * any scop pragma.
+ * Otherwise, set "known" if the position of the last such pragma
+ * could be determined and, if so, set "end" to its offset.
+ * The position cannot be determined if the main file uses _Pragma,
+ * since this may also produce scop pragmas.
+ * Neither can it be determined if the main file includes other files,
+ * since these may contain scop pragmas or define macros that expand
+ * to _Pragma.  In both cases, true is returned without setting "known".
+ *
+ * Conditional compilation directives are not taken into account,
+ * so a scop pragma that is later skipped by the preprocessor
+ * still results in a full parse, but no scop pragma is ever missed.
+ * The caller is responsible for not calling this function
+ * if macros may have been defined outside of the main file
+ * in some other way, e.g., on the command line.
+ */
+static bool prescan_scop_pragmas(SourceManager &SM, const LangOptions &LO,
+	bool &known, unsigned &end)
+{
+	FileID FID = SM.getMainFileID();
+	bool invalid = false;
+	llvm::StringRef data = SM.getBufferData(FID, &invalid);
+	bool found = false;
+	int state = 0;
+	Token tok;
+
+	known = false;
+	if (invalid)
+		return true;
+
+	Lexer lexer(SM.getLocForStartOfFile(FID), LO,
+			data.begin(), data.begin(), data.end());
+	do {
+		lexer.LexFromRawLexer(tok);
+		if (is_raw_identifier(SM, LO, tok, "_Pragma"))
+			return true;
+		if (tok.is(tok::hash) && tok.isAtStartOfLine())
+			state = 1;
+		else if (state == 1 && is_raw_identifier(SM, LO, tok, "pragma"))
+			state = 2;
+		else if (state == 1 &&
+			 (is_raw_identifier(SM, LO, tok, "include") ||
+			  is_raw_identifier(SM, LO, tok, "include_next") ||
+			  is_raw_identifier(SM, LO, tok, "import")))
+			return true;
+		else if (state == 2 &&
+			 (is_raw_identifier(SM, LO, tok, "scop") ||
+			  is_raw_identifier(SM, LO, tok, "endscop"))) {
+			found = true;
+			end = SM.getFileOffset(tok.getLocation());
+			state = 0;
+		} else
+			state = 0;
+	} while (tok.isNot(tok::eof));
+
+	known = found;
+	return found;
+}
+
 /* Add pet specific predefines to the preprocessor.
  * Currently, these are all pencil specific, so they are only
  * added if "pencil" is set.
@@ -1110,7 +1779,323 @@ void add_predefines(Preprocessor &PP, int pencil)
 	PP.setPredefines(s);
 }
 
-/* Extract a pet_scop from each function in the C source file called "filename".
+/* A pet_session keeps track of those parts of the clang setup
+ * that do not depend on the input file and that can therefore
+ * be reused across several extractions.
+ *
+ * "ctx" is the isl_ctx in which the pet_scops are constructed.
+ * "options" are the pet options, either those of "ctx" or
+ * (if "ctx" does not have any pet options) default options
+ * allocated by the session, in which case "options_allocated" is set.
+ * "file_managers" cache the results of file system lookups,
+ * including those performed during header search,
+ * for each working directory.  The empty string refers
+ * to the current working directory.
+ * "cc1_args" contains the frontend arguments constructed by the driver,
+ * which is fairly expensive to run, for input files that do not come
+ * with their own command line.  Since these arguments are mainly
+ * relevant for setting up the system include paths, they are shared
+ * by all such input files for which the driver selects the same language,
+ * i.e., all input files with the same extension.
+ * They are indexed by this extension (including the period), with buffers
+ * (which are always treated as C code) using "-".
+ * If the driver fails to construct the arguments for an input,
+ * e.g., because the input file does not exist, then nothing is stored,
+ * such that the driver is run again on the next input.
+ * "cache" is the cache of extracted pet_scops, if any.
+ * If "incremental" is set, then "incremental_scops" contains
+ * the pet_scops extracted from the latest version of each input,
+ * indexed by the name of the input.
+ *
+ * The files processed within a session are assumed not to change
+ * during the lifetime of the session.
+ * Only the contents of buffers passed to pet_session_extract_buffer
+ * may differ from one extraction to the next.
+ */
+struct pet_session {
+	isl_ctx *ctx;
+	pet_options *options;
+	bool options_allocated;
+	std::map<std::string, llvm::IntrusiveRefCntPtr<FileManager> >
+		file_managers;
+	std::map<std::string, std::vector<std::string> > cc1_args;
+	ScopCache cache;
+	int n_part;
+	int part;
+	pet_stats *stats;
+	bool incremental;
+	std::map<std::string, IncrementalScops> incremental_scops;
+};
+
+/* The input of an extraction.
+ *
+ * "filename" is the name of the input file.
+ * If "buffer" is not NULL, then it contains the "len" bytes
+ * of the input file, which is then not read from the file system.
+ * If "argv" is not NULL, then it contains the "argc" arguments
+ * of the compiler command line for compiling the input file,
+ * starting with the name of the compiler, and "directory" is
+ * the working directory of that command.
+ */
+struct ExtractionInput {
+	const char *filename;
+	const char *buffer;
+	size_t len;
+	const char *directory;
+	int argc;
+	const char **argv;
+
+	ExtractionInput(const char *filename) : filename(filename),
+		buffer(NULL), len(0), directory(NULL), argc(0), argv(NULL) {}
+};
+
+/* Allocate a pet_session for extracting pet_scops in "ctx".
+ */
+__isl_give pet_session *pet_session_alloc(isl_ctx *ctx)
+{
+	pet_session *session;
+
+	if (!ctx)
+		return NULL;
+
+	session = new pet_session;
+	session->ctx = ctx;
+	isl_ctx_ref(ctx);
+	session->options = isl_ctx_peek_pet_options(ctx);
+	session->options_allocated = false;
+	if (!session->options) {
+		session->options = pet_options_new_with_defaults();
+		session->options_allocated = true;
+	}
+	session->n_part = 1;
+	session->part = 0;
+	session->stats = NULL;
+	session->incremental = false;
+
+	return session;
+}
+
+/* Free "session" and return NULL.
+ */
+__isl_null pet_session *pet_session_free(__isl_take pet_session *session)
+{
+	if (!session)
+		return NULL;
+
+	if (session->options_allocated)
+		pet_options_free(session->options);
+	session->incremental_scops.clear();
+	isl_ctx_deref(session->ctx);
+	delete session;
+
+	return NULL;
+}
+
+/* Return the isl_ctx in which "session" constructs pet_scops.
+ */
+isl_ctx *pet_session_get_ctx(__isl_keep pet_session *session)
+{
+	return session ? session->ctx : NULL;
+}
+
+/* Use a cache of extracted pet_scops in "session".
+ * Before a pet_scop is extracted, "lookup" is called with a key
+ * that identifies all the information that may affect the result.
+ * If "lookup" returns a pet_scop, then it is used instead of
+ * extracting the pet_scop from the input.
+ * Otherwise, the pet_scop is extracted and passed to "store"
+ * along with the same key, before it is passed on to the user.
+ * Note that no warnings are produced for pet_scops found in the cache.
+ * If "lookup" is NULL, then no cache is used.
+ */
+isl_stat pet_session_set_scop_cache(__isl_keep pet_session *session,
+	__isl_give pet_scop *(*lookup)(isl_ctx *ctx, const char *key,
+		void *user),
+	isl_stat (*store)(const char *key, __isl_keep pet_scop *scop,
+		void *user),
+	void *user)
+{
+	if (!session)
+		return isl_stat_error;
+	session->cache.lookup = lookup;
+	session->cache.store = store;
+	session->cache.user = user;
+	return isl_stat_ok;
+}
+
+/* Collect statistics about subsequent extractions in "session"
+ * in "stats".  The caller is responsible for keeping "stats" alive
+ * for as long as it is used by "session".
+ */
+isl_stat pet_session_set_stats(__isl_keep pet_session *session,
+	__isl_keep pet_stats *stats)
+{
+	if (!session)
+		return isl_stat_error;
+	session->stats = stats;
+	return isl_stat_ok;
+}
+
+/* Only extract pet_scops from part "part" of the "n_part" parts
+ * of the candidate functions in subsequent extractions in "session".
+ * The candidate functions are those that contain a scop
+ * (or all function definitions in autodetect mode).
+ * They are distributed over the parts in a round-robin fashion
+ * in the order in which they appear in the input.
+ * Running an extraction for each of the parts, possibly concurrently
+ * in separate threads, each with its own isl_ctx, therefore produces
+ * the same pet_scops as a single extraction of all parts.
+ * The pet_scops can be put back in their original order
+ * by sorting them on the start of their locations.
+ */
+isl_stat pet_session_set_partition(__isl_keep pet_session *session,
+	int n_part, int part)
+{
+	if (!session)
+		return isl_stat_error;
+	if (n_part < 1 || part < 0 || part >= n_part)
+		isl_die(session->ctx, isl_error_invalid,
+			"invalid partition", return isl_stat_error);
+	session->n_part = n_part;
+	session->part = part;
+	return isl_stat_ok;
+}
+
+/* Turn incremental mode on or off in "session", depending on "incremental".
+ * In incremental mode, the pet_scops extracted from an input are kept
+ * in the session.  When the same input (as identified by its name)
+ * is extracted again, e.g., from an edited buffer, then the pet_scops
+ * of every function that has not changed are taken from the previous
+ * extraction instead of being extracted again.
+ * A function is considered to have changed if its definition
+ * or any of the declarations it depends on has changed.
+ * A function that has only moved in the input is considered unchanged,
+ * and the locations in its pet_scops are moved accordingly.
+ * Note that the input still needs to be parsed.
+ * No warnings are produced for pet_scops that are reused.
+ * Turning incremental mode off drops all pet_scops kept in the session.
+ */
+isl_stat pet_session_set_incremental(__isl_keep pet_session *session,
+	int incremental)
+{
+	if (!session)
+		return isl_stat_error;
+	session->incremental = incremental;
+	if (!incremental)
+		session->incremental_scops.clear();
+	return isl_stat_ok;
+}
+
+/* Return the FileManager of "session" for working directory "directory",
+ * creating it if needed.
+ * If "directory" is NULL, then return the FileManager
+ * for the current working directory.
+ */
+static FileManager *session_file_manager(pet_session *session,
+	const char *directory)
+{
+	std::string key = directory ? directory : "";
+	llvm::IntrusiveRefCntPtr<FileManager> &fm =
+		session->file_managers[key];
+
+	if (!fm) {
+		FileSystemOptions options;
+		options.WorkingDir = key;
+		fm = new FileManager(options);
+	}
+
+	return fm.get();
+}
+
+/* Return "filename" as an absolute path, interpreting it
+ * with respect to "directory" if it is a relative path.
+ */
+static std::string absolute_path(const char *directory, const char *filename)
+{
+	std::string path = filename;
+
+	if (!directory || path.empty() || path[0] == '/')
+		return path;
+	return std::string(directory) + "/" + path;
+}
+
+/* Return the extension of "filename", including the period,
+ * or the empty string if the base name of "filename" does not have
+ * an extension.
+ * The extension determines the language of an input file
+ * in the eyes of the driver.
+ */
+static std::string file_extension(const char *filename)
+{
+	const char *base = strrchr(filename, '/');
+	const char *dot;
+
+	base = base ? base + 1 : filename;
+	dot = strrchr(base, '.');
+	return dot ? dot : "";
+}
+
+/* Return the CompilerInvocation that should be used for parsing
+ * "input" within "session", or NULL if no such invocation
+ * can be constructed.
+ *
+ * If "input" comes with its own command line, then the driver
+ * is run on that command line (without the name of the compiler,
+ * which is replaced by the clang that pet is linked against).
+ * Since the driver checks the existence of the input file with
+ * respect to the current working directory, any argument
+ * that refers to the input file is replaced by an absolute path.
+ *
+ * Otherwise, the same frontend arguments are used for every input
+ * with the same language and they are only constructed the first time
+ * the driver succeeds in constructing them on "session"
+ * for an input in that language.
+ * If the input is not available on the file system,
+ * then the driver is told to compile C code from standard input instead.
+ */
+static CompilerInvocation *session_invocation(pet_session *session,
+	const ExtractionInput &input, DiagnosticsEngine &Diags)
+{
+	std::vector<const char *> driver_args;
+
+	if (input.argv) {
+		std::vector<std::string> args;
+		std::string path;
+
+		path = absolute_path(input.directory, input.filename);
+		for (int i = 1; i < input.argc; ++i) {
+			if (!strcmp(input.argv[i], input.filename))
+				driver_args.push_back(path.c_str());
+			else
+				driver_args.push_back(input.argv[i]);
+		}
+		if (!construct_cc1_args(driver_args, Diags, args))
+			return NULL;
+		return construct_invocation(args, Diags);
+	}
+
+	std::string key = input.buffer ? "-" : file_extension(input.filename);
+	std::map<std::string, std::vector<std::string> >::iterator it;
+	it = session->cc1_args.find(key);
+	if (it == session->cc1_args.end()) {
+		std::vector<std::string> args;
+		if (input.buffer) {
+			driver_args.push_back("-x");
+			driver_args.push_back("c");
+			driver_args.push_back("-");
+		} else
+			driver_args.push_back(input.filename);
+		if (!construct_cc1_args(driver_args, Diags, args))
+			return NULL;
+		it = session->cc1_args.insert(make_pair(key, args)).first;
+	}
+	return construct_invocation(it->second, Diags);
+}
+
+/* Extract a pet_scop from each function in the C source file
+ * described by "input".
+ * If input.buffer is not NULL, then the contents of this file are
+ * taken from this buffer rather than from the file system.
  * Each detected scop is passed to "fn".
  * If "function" is not NULL, only extract a pet_scop from the function
  * with that name.
@@ -1118,13 +2103,31 @@ void add_predefines(Preprocessor &PP, int pencil)
  * Otherwise, extract the pet_scop from the region delimited
  * by "scop" and "endscop" pragmas.
  *
- * We first set up the clang parser and then try to extract the
+ * We first set up the clang parser, reusing the parts of the setup
+ * that are cached in "session", and then try to extract the
  * pet_scop from the appropriate function(s) in PetASTConsumer.
+ * If scops are delimited by pragmas, then the main file is
+ * first scanned for such pragmas without preprocessing it
+ * and nothing more is done if there are none,
+ * unless summaries of all functions need to be written.
+ * This scan is skipped if macros may be defined before the start
+ * of the main file, i.e., through macro definitions in "options",
+ * a precompiled header or an explicit compiler command line.
+ * If statistics are being collected, then the time spent
+ * outside of the parser (and the phases started by the parser)
+ * is attributed to the "setup" phase.
+ * In incremental mode, the pet_scops kept for the previous version
+ * of the input are replaced by those of the current version,
+ * unless the extraction fails.
  */
-static isl_stat foreach_scop_in_C_source(isl_ctx *ctx,
-	const char *filename, const char *function, pet_options *options,
+static isl_stat foreach_scop_in_C_source(pet_session *session,
+	const ExtractionInput &input, const char *function,
 	isl_stat (*fn)(struct pet_scop *scop, void *user), void *user)
 {
+	isl_ctx *ctx = session->ctx;
+	pet_options *options = session->options;
+	pet_stats_set_file(session->stats, input.filename);
+	pet_stats_phase phase(session->stats, "setup");
 	CompilerInstance *Clang = new CompilerInstance();
 	create_diagnostics(Clang);
 	DiagnosticsEngine &Diags = Clang->getDiagnostics();
@@ -1132,12 +2135,38 @@ static isl_stat foreach_scop_in_C_source(isl_ctx *ctx,
 	TargetInfo *target = create_target_info(Clang, Diags);
 	Clang->setTarget(target);
 	set_lang_defaults(Clang);
-	CompilerInvocation *invocation = construct_invocation(filename, Diags);
+	CompilerInvocation *invocation;
+	invocation = session_invocation(session, input, Diags);
 	if (invocation)
 		set_invocation(Clang, invocation);
 	Diags.setClient(construct_printer(Clang, options->pencil));
-	Clang->createFileManager();
+	Clang->setFileManager(session_file_manager(session, input.directory));
 	Clang->createSourceManager(Clang->getFileManager());
+
+	if (input.buffer) {
+		create_main_file_id(Clang->getSourceManager(), input.filename,
+					input.buffer, input.len);
+	} else {
+		const FileEntry *file = getFile(Clang, input.filename);
+		if (!file)
+			isl_die(ctx, isl_error_unknown, "unable to open file",
+				do { delete Clang; return isl_stat_error; }
+				while (0));
+		create_main_file_id(Clang->getSourceManager(), file);
+	}
+
+	bool last_scop_known = false;
+	unsigned last_scop_end = 0;
+	if (!options->autodetect &&
+	    !(options->summaries && options->write_summaries) &&
+	    options->n_define == 0 && !options->pch && !input.argv &&
+	    !prescan_scop_pragmas(Clang->getSourceManager(),
+			Clang->getLangOpts(), last_scop_known, last_scop_end)) {
+		session->incremental_scops.erase(input.filename);
+		delete Clang;
+		return isl_stat_ok;
+	}
+
 	HeaderSearchOptions &HSO = Clang->getHeaderSearchOpts();
 	HSO.ResourceDir = ResourceDir;
 	for (int i = 0; i < options->n_path; ++i)
@@ -1145,6 +2174,8 @@ static isl_stat foreach_scop_in_C_source(isl_ctx *ctx,
 	PreprocessorOptions &PO = Clang->getPreprocessorOpts();
 	for (int i = 0; i < options->n_define; ++i)
 		PO.addMacroDef(options->defines[i]);
+	if (options->pch)
+		PO.ImplicitPCHInclude = options->pch;
 	create_preprocessor(Clang);
 	Preprocessor &PP = Clang->getPreprocessor();
 	add_predefines(PP, options->pencil);
@@ -1153,15 +2184,24 @@ static isl_stat foreach_scop_in_C_source(isl_ctx *ctx,
 
 	ScopLocList scops;
 
-	const FileEntry *file = getFile(Clang, filename);
-	if (!file)
-		isl_die(ctx, isl_error_unknown, "unable to open file",
-			do { delete Clang; return isl_stat_error; } while (0));
-	create_main_file_id(Clang->getSourceManager(), file);
-
 	Clang->createASTContext();
+	if (options->pch)
+		create_pch_external_ast_source(Clang, options->pch);
 	PetASTConsumer consumer(ctx, PP, Clang->getASTContext(), Diags,
 				scops, function, options, fn, user);
+	consumer.last_scop_known = last_scop_known;
+	consumer.last_scop_end = last_scop_end;
+	consumer.cache = &session->cache;
+	consumer.n_part = session->n_part;
+	consumer.part = session->part;
+	consumer.stats = session->stats;
+	IncrementalScops current;
+	IncrementalScops *previous = NULL;
+	if (session->incremental) {
+		previous = &session->incremental_scops[input.filename];
+		consumer.previous = previous;
+		consumer.current = &current;
+	}
 	Sema *sema = new Sema(PP, Clang->getASTContext(), consumer);
 
 	if (!options->autodetect) {
@@ -1174,42 +2214,114 @@ static isl_stat foreach_scop_in_C_source(isl_ctx *ctx,
 	consumer.add_pragma_handlers(sema);
 
 	Diags.getClient()->BeginSourceFile(Clang->getLangOpts(), &PP);
-	ParseAST(*sema);
+	{
+		pet_stats_phase phase(session->stats, "parse");
+		ParseAST(*sema, false, true);
+	}
 	Diags.getClient()->EndSourceFile();
 
 	delete sema;
 	delete Clang;
 
+	if (previous && !consumer.error)
+		previous->swap(current);
+
 	return consumer.error ? isl_stat_error : isl_stat_ok;
 }
 
+/* Extract a pet_scop from each function in the C source file called "filename"
+ * within "session".
+ * Each detected scop is passed to "fn".
+ * If "function" is not NULL, only extract a pet_scop from the function
+ * with that name.
+ */
+isl_stat pet_session_extract(__isl_keep pet_session *session,
+	const char *filename, const char *function,
+	isl_stat (*fn)(__isl_take pet_scop *scop, void *user), void *user)
+{
+	if (!session)
+		return isl_stat_error;
+	return foreach_scop_in_C_source(session, ExtractionInput(filename),
+					function, fn, user);
+}
+
+/* Extract a pet_scop from each function in the C source file called "filename"
+ * within "session", using the include paths, macro definitions and
+ * other settings from the compiler command line
+ * in the "argc" elements of "argv".
+ * The first element is the name of the compiler, which is ignored.
+ * "directory" is the working directory of the compiler command
+ * and "filename" as well as any relative paths on the command line
+ * are interpreted with respect to this directory.
+ * This information is typically obtained from a compilation database.
+ * Each detected scop is passed to "fn".
+ * If "function" is not NULL, only extract a pet_scop from the function
+ * with that name.
+ */
+isl_stat pet_session_extract_with_command(__isl_keep pet_session *session,
+	const char *directory, const char *filename,
+	int argc, const char **argv, const char *function,
+	isl_stat (*fn)(__isl_take pet_scop *scop, void *user), void *user)
+{
+	ExtractionInput input(filename);
+
+	if (!session || !filename || argc < 1 || !argv)
+		return isl_stat_error;
+	input.directory = directory;
+	input.argc = argc;
+	input.argv = argv;
+	return foreach_scop_in_C_source(session, input, function, fn, user);
+}
+
+/* Extract a pet_scop from each function in the C source code
+ * in the "len" bytes of "buffer" within "session".
+ * "name" is the name under which the code is presented
+ * in diagnostics.
+ * Each detected scop is passed to "fn".
+ * If "function" is not NULL, only extract a pet_scop from the function
+ * with that name.
+ */
+isl_stat pet_session_extract_buffer(__isl_keep pet_session *session,
+	const char *name, const char *buffer, size_t len,
+	const char *function,
+	isl_stat (*fn)(__isl_take pet_scop *scop, void *user), void *user)
+{
+	ExtractionInput input(name ? name : "<buffer>");
+
+	if (!session || !buffer)
+		return isl_stat_error;
+	input.buffer = buffer;
+	input.len = len;
+	return foreach_scop_in_C_source(session, input, function, fn, user);
+}
+
 /* Extract a pet_scop from each function in the C source file called "filename".
+ * If "buffer" is not NULL, then the contents of this file are
+ * taken from the "len" bytes in "buffer".
  * Each detected scop is passed to "fn".
  *
- * This wrapper around foreach_scop_in_C_source is mainly used to ensure
- * that all objects on the stack (of that function) are destroyed before we
- * call llvm_shutdown.
+ * This wrapper around foreach_scop_in_C_source sets up a session
+ * for this single extraction.
+ * Note that llvm_shutdown is not called since other threads
+ * may still be using LLVM.
  */
 static isl_stat pet_foreach_scop_in_C_source(isl_ctx *ctx,
-	const char *filename, const char *function,
+	const char *filename, const char *buffer, size_t len,
+	const char *function,
 	isl_stat (*fn)(struct pet_scop *scop, void *user), void *user)
 {
 	isl_stat r;
-	pet_options *options;
-	bool allocated = false;
-
-	options = isl_ctx_peek_pet_options(ctx);
-	if (!options) {
-		options = pet_options_new_with_defaults();
-		allocated = true;
-	}
+	pet_session *session;
 
-	r = foreach_scop_in_C_source(ctx, filename, function, options,
-					fn, user);
-	llvm::llvm_shutdown();
+	session = pet_session_alloc(ctx);
+	if (!session)
+		return isl_stat_error;
 
-	if (allocated)
-		pet_options_free(options);
+	ExtractionInput input(filename);
+	input.buffer = buffer;
+	input.len = len;
+	r = foreach_scop_in_C_source(session, input, function, fn, user);
+	pet_session_free(session);
 
 	return r;
 }
@@ -1243,7 +2355,32 @@ struct pet_scop *pet_scop_extract_from_C_source(isl_ctx *ctx,
 {
 	pet_scop *scop = NULL;
 
-	pet_foreach_scop_in_C_source(ctx, filename, function,
+	pet_foreach_scop_in_C_source(ctx, filename, NULL, 0, function,
+					&set_first_scop, &scop);
+
+	return scop;
+}
+
+/* Extract a pet_scop from the C source code in the "len" bytes
+ * of "buffer", without accessing the file system for the input itself.
+ * "name" is the name under which the code is presented in diagnostics.
+ * If "function" is not NULL, extract the pet_scop from the function
+ * with that name.
+ *
+ * Note that include directives with a relative path are not resolved
+ * with respect to the directory in "name", since the input
+ * does not correspond to an actual file.
+ */
+struct pet_scop *pet_scop_extract_from_C_buffer(isl_ctx *ctx,
+	const char *name, const char *buffer, size_t len, const char *function)
+{
+	pet_scop *scop = NULL;
+
+	if (!buffer)
+		return NULL;
+	if (!name)
+		name = "<buffer>";
+	pet_foreach_scop_in_C_source(ctx, name, buffer, len, function,
 					&set_first_scop, &scop);
 
 	return scop;
@@ -1308,8 +2445,10 @@ error:
 
 /* Transform the C source file "input" by rewriting each scop
  * through a call to "transform".
- * When autodetecting scops, at most one scop per function is rewritten.
- * The transformed C code is written to "output".
+ * If "buffer" is not NULL, then the contents of "input" are
+ * taken from the "len" bytes of "buffer" instead.
+ * "in" is a stream containing the same contents.
+ * The transformed C code is written to "out".
  *
  * For each scop we find, we first copy the input text code
  * from the end of the previous scop (or the beginning of the file
@@ -1318,21 +2457,16 @@ error:
  * At the end we copy everything from the end of the final scop
  * until the end of the input file to "output".
  */
-int pet_transform_C_source(isl_ctx *ctx, const char *input, FILE *out,
+static int transform_C_source(isl_ctx *ctx, const char *input,
+	const char *buffer, size_t len, FILE *in, FILE *out,
 	__isl_give isl_printer *(*transform)(__isl_take isl_printer *p,
 		struct pet_scop *scop, void *user), void *user)
 {
 	struct pet_transform_data data;
 	int r;
 
-	data.in = stdin;
+	data.in = in;
 	data.out = out;
-	if (input && strcmp(input, "-")) {
-		data.in = fopen(input, "r");
-		if (!data.in)
-			isl_die(ctx, isl_error_unknown, "unable to open file",
-				return -1);
-	}
 
 	data.p = isl_printer_to_file(ctx, data.out);
 	data.p = isl_printer_set_output_format(data.p, ISL_FORMAT_C);
@@ -1340,7 +2474,7 @@ int pet_transform_C_source(isl_ctx *ctx, const char *input, FILE *out,
 	data.transform = transform;
 	data.user = user;
 	data.end = 0;
-	r = pet_foreach_scop_in_C_source(ctx, input, NULL,
+	r = pet_foreach_scop_in_C_source(ctx, input, buffer, len, NULL,
 					&pet_transform, &data);
 
 	isl_printer_free(data.p);
@@ -1349,8 +2483,82 @@ int pet_transform_C_source(isl_ctx *ctx, const char *input, FILE *out,
 	if (r == 0 && copy(data.in, data.out, data.end, -1) < 0)
 		r = -1;
 
-	if (data.in != stdin)
-		fclose(data.in);
+	return r;
+}
+
+/* Transform the C source file "input" by rewriting each scop
+ * through a call to "transform".
+ * When autodetecting scops, at most one scop per function is rewritten.
+ * The transformed C code is written to "output".
+ */
+int pet_transform_C_source(isl_ctx *ctx, const char *input, FILE *out,
+	__isl_give isl_printer *(*transform)(__isl_take isl_printer *p,
+		struct pet_scop *scop, void *user), void *user)
+{
+	FILE *in;
+	int r;
+
+	in = stdin;
+	if (input && strcmp(input, "-")) {
+		in = fopen(input, "r");
+		if (!in)
+			isl_die(ctx, isl_error_unknown, "unable to open file",
+				return -1);
+	}
+
+	r = transform_C_source(ctx, input, NULL, 0, in, out, transform, user);
+
+	if (in != stdin)
+		fclose(in);
 
 	return r;
 }
+
+/* Transform the C source code in the "len" bytes of "buffer"
+ * by rewriting each scop through a call to "transform" and
+ * return the transformed C code, or NULL on error.
+ * "name" is the name under which the code is presented in diagnostics.
+ * When autodetecting scops, at most one scop per function is rewritten.
+ *
+ * The input and output are accessed through in-memory streams
+ * such that the file system is not accessed for either of them.
+ * The same streams are used by pet_scop_print_original.
+ */
+__isl_give char *pet_transform_C_buffer(isl_ctx *ctx, const char *name,
+	const char *buffer, size_t len,
+	__isl_give isl_printer *(*transform)(__isl_take isl_printer *p,
+		struct pet_scop *scop, void *user), void *user)
+{
+	FILE *in, *out;
+	char *res = NULL;
+	size_t res_len;
+	int r;
+
+	if (!buffer)
+		return NULL;
+	if (!name)
+		name = "<buffer>";
+	in = fmemopen((void *) buffer, len, "r");
+	if (!in)
+		isl_die(ctx, isl_error_unknown, "unable to open buffer",
+			return NULL);
+	out = open_memstream(&res, &res_len);
+	if (!out) {
+		fclose(in);
+		isl_die(ctx, isl_error_unknown, "unable to open buffer",
+			return NULL);
+	}
+
+	r = transform_C_source(ctx, name, buffer, len, in, out,
+				transform, user);
+
+	fclose(in);
+	if (fclose(out) != 0)
+		r = -1;
+	if (r < 0) {
+		free(res);
+		return NULL;
+	}
+
+	return res;
+}
@@ -0,0 +1,615 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <isl/arg.h>
+#include <isl/ctx.h>
+
+#include <pet.h>
+
+#include "scop.h"
+#include "scop_yaml.h"
+
+struct options {
+	int threads;
+	int partition;
+	int incremental;
+};
+
+ISL_ARGS_START(struct options, options_args)
+ISL_ARG_INT(struct options, threads, 0, "threads", "n", 4,
+	"number of threads")
+ISL_ARG_BOOL(struct options, partition, 0, "partition", 0,
+	"extract the scops of each file in parts from several threads")
+ISL_ARG_BOOL(struct options, incremental, 0, "incremental", 0,
+	"extract the scops of each file again after an edit "
+	"in incremental mode")
+ISL_ARGS_END
+
+ISL_ARG_DEF(options, struct options, options_args)
+
+/* The list of input files, shared by all threads.
+ */
+struct input_list {
+	int n;
+	char **files;
+};
+
+/* Data for a single thread.
+ *
+ * "list" is the list of input files.
+ * "offset" is the position in "list" of the first file
+ * processed by the thread.
+ * "failed" is set if any extracted scop differs from its reference.
+ */
+struct thread_data {
+	struct input_list *list;
+	int offset;
+	int failed;
+};
+
+/* Extract a pet_scop from "input" in "ctx", write it out in YAML form
+ * and read it back in, such that it can be compared
+ * to the reference scop in the same way as in pet_scop_cmp.
+ * Return NULL if no scop could be extracted.
+ */
+static struct pet_scop *extract(isl_ctx *ctx, const char *input)
+{
+	struct pet_scop *scop;
+	FILE *file;
+
+	scop = pet_scop_extract_from_C_source(ctx, input, NULL);
+	if (!scop)
+		return NULL;
+	file = tmpfile();
+	if (!file)
+		return pet_scop_free(scop);
+	pet_scop_emit(file, scop);
+	pet_scop_free(scop);
+	rewind(file);
+	scop = pet_scop_parse(ctx, file);
+	fclose(file);
+
+	return scop;
+}
+
+/* Read the reference scop corresponding to "input",
+ * i.e., the file with the same name but with extension ".scop".
+ */
+static struct pet_scop *read_reference(isl_ctx *ctx, const char *input)
+{
+	struct pet_scop *scop;
+	size_t len = strlen(input);
+	char *name;
+	FILE *file;
+
+	name = malloc(len + sizeof(".scop"));
+	if (!name)
+		return NULL;
+	strcpy(name, input);
+	if (len >= 2 && !strcmp(name + len - 2, ".c"))
+		name[len - 2] = '\0';
+	strcat(name, ".scop");
+	file = fopen(name, "r");
+	free(name);
+	if (!file)
+		return NULL;
+	scop = pet_scop_parse(ctx, file);
+	fclose(file);
+
+	return scop;
+}
+
+/* Extract a pet_scop from each of the input files in its own isl_ctx,
+ * starting at data->offset, and compare the result to the reference.
+ */
+static void *run_thread(void *user)
+{
+	struct thread_data *data = user;
+	struct input_list *list = data->list;
+	isl_ctx *ctx;
+	int i;
+
+	ctx = isl_ctx_alloc_with_pet_options();
+	if (!ctx) {
+		data->failed = 1;
+		return NULL;
+	}
+
+	for (i = 0; i < list->n; ++i) {
+		const char *input = list->files[(data->offset + i) % list->n];
+		struct pet_scop *scop, *ref;
+		int equal;
+
+		scop = extract(ctx, input);
+		ref = read_reference(ctx, input);
+		equal = pet_scop_is_equal(scop, ref);
+		pet_scop_free(scop);
+		pet_scop_free(ref);
+		if (equal < 0 || !equal) {
+			fprintf(stderr, "%s: mismatch\n", input);
+			data->failed = 1;
+		}
+	}
+
+	isl_ctx_free(ctx);
+	return NULL;
+}
+
+/* A list of pet_scops, each written out in YAML form to its own file.
+ */
+struct scop_files {
+	int n;
+	FILE **files;
+};
+
+/* Write out "scop" in YAML form to a new file and add it to "user",
+ * a struct scop_files.
+ */
+static isl_stat add_scop_file(__isl_take pet_scop *scop, void *user)
+{
+	struct scop_files *list = user;
+	FILE **files;
+	FILE *file;
+
+	file = tmpfile();
+	files = realloc(list->files, (list->n + 1) * sizeof(FILE *));
+	if (!file || !files) {
+		if (file)
+			fclose(file);
+		if (files)
+			list->files = files;
+		pet_scop_free(scop);
+		return isl_stat_error;
+	}
+	list->files = files;
+	pet_scop_emit(file, scop);
+	pet_scop_free(scop);
+	rewind(file);
+	list->files[list->n++] = file;
+	return isl_stat_ok;
+}
+
+/* Close all files in "list".
+ */
+static void scop_files_clear(struct scop_files *list)
+{
+	int i;
+
+	for (i = 0; i < list->n; ++i)
+		fclose(list->files[i]);
+	free(list->files);
+	list->n = 0;
+	list->files = NULL;
+}
+
+/* Data for a single thread extracting a part of the scops of "input".
+ *
+ * "n_part" is the number of parts and "part" the part
+ * handled by the thread.
+ * "scops" collects the extracted scops.
+ */
+struct part_data {
+	const char *input;
+	int n_part;
+	int part;
+	struct scop_files scops;
+	int failed;
+};
+
+/* Extract part data->part of the scops in data->input
+ * in a session with its own isl_ctx.
+ */
+static void *run_part(void *user)
+{
+	struct part_data *data = user;
+	isl_ctx *ctx;
+	pet_session *session;
+
+	ctx = isl_ctx_alloc_with_pet_options();
+	session = pet_session_alloc(ctx);
+	if (pet_session_set_partition(session, data->n_part, data->part) < 0 ||
+	    pet_session_extract(session, data->input, NULL,
+				&add_scop_file, &data->scops) < 0)
+		data->failed = 1;
+	pet_session_free(session);
+	isl_ctx_free(ctx);
+	return NULL;
+}
+
+/* Read back the scops in "list" into "ctx" and store them in "scops",
+ * starting at position "pos".
+ */
+static int read_scops(isl_ctx *ctx, struct scop_files *list,
+	struct pet_scop **scops, int pos)
+{
+	int i;
+
+	for (i = 0; i < list->n; ++i) {
+		scops[pos + i] = pet_scop_parse(ctx, list->files[i]);
+		if (!scops[pos + i])
+			return -1;
+	}
+	return 0;
+}
+
+/* Compare the starts of the locations of the two scops.
+ */
+static int cmp_start(const void *a, const void *b)
+{
+	struct pet_scop *scop_a = *(struct pet_scop * const *) a;
+	struct pet_scop *scop_b = *(struct pet_scop * const *) b;
+	unsigned start_a = pet_loc_get_start(scop_a->loc);
+	unsigned start_b = pet_loc_get_start(scop_b->loc);
+
+	return start_a < start_b ? -1 : start_a > start_b ? 1 : 0;
+}
+
+/* Extract all scops from "input" in "n" parts, each from its own thread,
+ * put them back in their original order and check that the result
+ * is the same as that of extracting all scops from a single thread.
+ * Return 0 if the results are the same and 1 otherwise.
+ */
+static int check_partition(isl_ctx *ctx, const char *input, int n)
+{
+	struct scop_files serial = { 0, NULL };
+	struct part_data *data;
+	pthread_t *threads;
+	struct pet_scop **scops;
+	pet_session *session;
+	int i, n_scop, pos;
+	int failed = 0;
+
+	session = pet_session_alloc(ctx);
+	if (pet_session_extract(session, input, NULL,
+				&add_scop_file, &serial) < 0)
+		failed = 1;
+	pet_session_free(session);
+
+	data = calloc(n, sizeof(*data));
+	threads = calloc(n, sizeof(*threads));
+	if (!data || !threads)
+		return 1;
+	for (i = 0; i < n; ++i) {
+		data[i].input = input;
+		data[i].n_part = n;
+		data[i].part = i;
+		if (pthread_create(&threads[i], NULL, &run_part, &data[i]))
+			return 1;
+	}
+	n_scop = 0;
+	for (i = 0; i < n; ++i) {
+		pthread_join(threads[i], NULL);
+		if (data[i].failed)
+			failed = 1;
+		n_scop += data[i].scops.n;
+	}
+	if (n_scop != serial.n)
+		failed = 1;
+
+	scops = calloc(2 * n_scop + 1, sizeof(*scops));
+	if (!scops)
+		failed = 1;
+	pos = 0;
+	for (i = 0; !failed && i < n; ++i) {
+		if (read_scops(ctx, &data[i].scops, scops, pos) < 0)
+			failed = 1;
+		pos += data[i].scops.n;
+	}
+	if (!failed && read_scops(ctx, &serial, scops, n_scop) < 0)
+		failed = 1;
+	if (!failed)
+		qsort(scops, n_scop, sizeof(*scops), &cmp_start);
+	for (i = 0; !failed && i < n_scop; ++i) {
+		int equal = pet_scop_is_equal(scops[i], scops[n_scop + i]);
+		if (equal < 0 || !equal)
+			failed = 1;
+	}
+	if (failed)
+		fprintf(stderr, "%s: partition mismatch\n", input);
+
+	for (i = 0; scops && i < 2 * n_scop; ++i)
+		pet_scop_free(scops[i]);
+	free(scops);
+	for (i = 0; i < n; ++i)
+		scop_files_clear(&data[i].scops);
+	scop_files_clear(&serial);
+	free(threads);
+	free(data);
+
+	return failed;
+}
+
+/* Check for each file in "list" that extracting its scops
+ * in "n" parts from separate threads produces the same result
+ * as extracting them all at once.
+ */
+static int check_partitions(struct input_list *list, int n)
+{
+	isl_ctx *ctx;
+	int i;
+	int failed = 0;
+
+	ctx = isl_ctx_alloc_with_pet_options();
+	if (!ctx)
+		return 1;
+	for (i = 0; i < list->n; ++i)
+		if (check_partition(ctx, list->files[i], n))
+			failed = 1;
+	isl_ctx_free(ctx);
+
+	return failed;
+}
+
+/* Return a newly allocated buffer containing "prefix",
+ * followed by the contents of "input", and set "len" to its length.
+ */
+static char *read_with_prefix(const char *input, const char *prefix,
+	size_t *len)
+{
+	FILE *file;
+	char *buffer;
+	long size = 0;
+	size_t n = strlen(prefix);
+
+	file = fopen(input, "r");
+	if (!file)
+		return NULL;
+	buffer = NULL;
+	if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0) {
+		rewind(file);
+		buffer = malloc(n + size);
+	}
+	if (buffer) {
+		memcpy(buffer, prefix, n);
+		if (fread(buffer + n, 1, size, file) != (size_t) size) {
+			free(buffer);
+			buffer = NULL;
+		}
+		*len = n + size;
+	}
+	fclose(file);
+
+	return buffer;
+}
+
+/* Extract the scops from the "len" bytes of "buffer", presented as "input",
+ * within "session" and add them to "scops".
+ */
+static int extract_buffer(pet_session *session, const char *input,
+	const char *buffer, size_t len, struct scop_files *scops)
+{
+	if (pet_session_extract_buffer(session, input, buffer, len, NULL,
+					&add_scop_file, scops) < 0)
+		return -1;
+	return 0;
+}
+
+/* Check that the scops in "list1" are equal to those in "list2",
+ * in the same order.
+ * Return 0 if they are and 1 otherwise.
+ */
+static int cmp_scop_files(isl_ctx *ctx, struct scop_files *list1,
+	struct scop_files *list2)
+{
+	int i;
+	int failed = 0;
+
+	if (list1->n != list2->n)
+		return 1;
+	for (i = 0; !failed && i < list1->n; ++i) {
+		struct pet_scop *scop1, *scop2;
+		int equal;
+
+		scop1 = pet_scop_parse(ctx, list1->files[i]);
+		scop2 = pet_scop_parse(ctx, list2->files[i]);
+		equal = scop1 && scop2 ? pet_scop_is_equal(scop1, scop2) : -1;
+		if (equal < 0 || !equal)
+			failed = 1;
+		pet_scop_free(scop1);
+		pet_scop_free(scop2);
+	}
+
+	return failed;
+}
+
+/* Extract the scops of "input" in incremental mode, then extract them
+ * again after an edit that moves all code in the input and
+ * check that the result is the same as that of extracting
+ * the scops from the edited input from scratch.
+ * Finally, undo the edit and check that the result is the same
+ * as that of the original extraction.
+ * Return 0 if the results are the same and 1 otherwise.
+ */
+static int check_incremental(isl_ctx *ctx, const char *input)
+{
+	struct scop_files original = { 0, NULL };
+	struct scop_files edited = { 0, NULL };
+	struct scop_files reference = { 0, NULL };
+	struct scop_files undone = { 0, NULL };
+	pet_session *session, *fresh;
+	char *buffer, *edited_buffer;
+	size_t len, edited_len;
+	int failed = 0;
+
+	buffer = read_with_prefix(input, "", &len);
+	edited_buffer = read_with_prefix(input, "/* edit */\n\n",
+					&edited_len);
+	session = pet_session_alloc(ctx);
+	fresh = pet_session_alloc(ctx);
+	if (!buffer || !edited_buffer ||
+	    pet_session_set_incremental(session, 1) < 0 ||
+	    extract_buffer(session, input, buffer, len, &original) < 0 ||
+	    extract_buffer(session, input, edited_buffer, edited_len,
+			    &edited) < 0 ||
+	    extract_buffer(fresh, input, edited_buffer, edited_len,
+			    &reference) < 0 ||
+	    extract_buffer(session, input, buffer, len, &undone) < 0)
+		failed = 1;
+	pet_session_free(fresh);
+	pet_session_free(session);
+
+	if (!failed)
+		failed = cmp_scop_files(ctx, &edited, &reference);
+	if (!failed)
+		failed = cmp_scop_files(ctx, &undone, &original);
+	if (failed)
+		fprintf(stderr, "%s: incremental mismatch\n", input);
+
+	scop_files_clear(&original);
+	scop_files_clear(&edited);
+	scop_files_clear(&reference);
+	scop_files_clear(&undone);
+	free(edited_buffer);
+	free(buffer);
+
+	return failed;
+}
+
+/* Check for each file in "list" that extracting its scops
+ * in incremental mode after an edit produces the same result
+ * as extracting them from scratch.
+ */
+static int check_incrementals(struct input_list *list)
+{
+	isl_ctx *ctx;
+	int i;
+	int failed = 0;
+
+	ctx = isl_ctx_alloc_with_pet_options();
+	if (!ctx)
+		return 1;
+	for (i = 0; i < list->n; ++i)
+		if (check_incremental(ctx, list->files[i]))
+			failed = 1;
+	isl_ctx_free(ctx);
+
+	return failed;
+}
+
+/* Read the list of input files from "in", one per line.
+ */
+static int read_input_list(struct input_list *list, FILE *in)
+{
+	char line[4096];
+
+	while (fgets(line, sizeof(line), in)) {
+		char **files;
+		char *file;
+
+		file = strtok(line, " \t\r\n");
+		if (!file)
+			continue;
+		files = realloc(list->files, (list->n + 1) * sizeof(char *));
+		if (!files)
+			return -1;
+		list->files = files;
+		list->files[list->n] = strdup(file);
+		if (!list->files[list->n])
+			return -1;
+		list->n++;
+	}
+
+	return 0;
+}
+
+/* Read a list of C source files from standard input and
+ * extract a pet_scop from each of them from several threads
+ * at the same time, each with its own isl_ctx.
+ * Each thread processes all files, but starting at a different file.
+ * Check that each of the extracted scops is equal to the reference
+ * scop in the corresponding .scop file.
+ * If the partition option is set, then instead check that
+ * the scops of each file can be extracted in parts from several threads.
+ * If the incremental option is set, then instead check that
+ * the scops of each file are extracted correctly in incremental mode.
+ * Return 0 if all scops are equal to their references and 1 otherwise.
+ */
+int main(int argc, char **argv)
+{
+	struct options *options;
+	struct input_list list = { 0, NULL };
+	struct thread_data *data;
+	pthread_t *threads;
+	int i, n;
+	int partition, incremental;
+	int failed = 0;
+
+	options = options_new_with_defaults();
+	argc = options_parse(options, argc, argv, ISL_ARG_ALL);
+	n = options->threads;
+	partition = options->partition;
+	incremental = options->incremental;
+	options_free(options);
+
+	if (read_input_list(&list, stdin) < 0 || list.n == 0 || n < 1)
+		return 1;
+
+	if (partition || incremental) {
+		if (partition)
+			failed = check_partitions(&list, n);
+		else
+			failed = check_incrementals(&list);
+		for (i = 0; i < list.n; ++i)
+			free(list.files[i]);
+		free(list.files);
+		return failed;
+	}
+
+	data = calloc(n, sizeof(*data));
+	threads = calloc(n, sizeof(*threads));
+	if (!data || !threads)
+		return 1;
+	for (i = 0; i < n; ++i) {
+		data[i].list = &list;
+		data[i].offset = (i * list.n) / n;
+		if (pthread_create(&threads[i], NULL, &run_thread, &data[i]))
+			return 1;
+	}
+	for (i = 0; i < n; ++i) {
+		pthread_join(threads[i], NULL);
+		if (data[i].failed)
+			failed = 1;
+	}
+
+	for (i = 0; i < list.n; ++i)
+		free(list.files[i]);
+	free(list.files);
+	free(threads);
+	free(data);
+
+	return failed;
+}
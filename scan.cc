@@ -69,7 +69,9 @@
 #include "scan.h"
 #include "scop.h"
 #include "scop_plus.h"
+#include "stats.h"
 #include "substituter.h"
+#include "summary_db.h"
 #include "tree.h"
 #include "tree2scop.h"
 
@@ -193,16 +195,27 @@ static bool const_base(QualType qt)
 	return qt.isConstQualified();
 }
 
-PetScan::~PetScan()
+PetScanCache::~PetScanCache()
 {
 	std::map<const Type *, pet_expr *>::iterator it;
 	std::map<FunctionDecl *, pet_function_summary *>::iterator it_s;
+	std::map<isl_id *, pet_array *>::iterator it_a;
 
 	for (it = type_size.begin(); it != type_size.end(); ++it)
 		pet_expr_free(it->second);
 	for (it_s = summary_cache.begin(); it_s != summary_cache.end(); ++it_s)
 		pet_function_summary_free(it_s->second);
+	for (it_s = fallback_summary_cache.begin();
+	     it_s != fallback_summary_cache.end(); ++it_s)
+		pet_function_summary_free(it_s->second);
+	for (it_a = arrays.begin(); it_a != arrays.end(); ++it_a) {
+		isl_id_free(it_a->first);
+		pet_array_free(it_a->second);
+	}
+}
 
+PetScan::~PetScan()
+{
 	isl_id_to_pet_expr_free(id_size);
 	isl_union_map_free(value_bounds);
 }
@@ -1494,34 +1507,73 @@ void PetScan::add_new_used_names(const std::set<std::string> &names)
 	}
 }
 
+/* Return the names declared in "DC", as cached in "cache".
+ * Any declarations that have been added to "DC" since
+ * the previous call are added to the cache first.
+ */
+static PetDeclNames &get_decl_names(PetScanCache &cache, DeclContext *DC)
+{
+	PetDeclNames &names = cache.decl_names[DC];
+	DeclContext::decl_iterator it = DC->decls_begin();
+	Decl *D;
+
+	if (names.last)
+		D = names.last->getNextDeclInContext();
+	else
+		D = it == DC->decls_end() ? NULL : *it;
+	for (; D; D = D->getNextDeclInContext()) {
+		names.last = D;
+		if (!isa<NamedDecl>(D))
+			continue;
+		names.count[cast<NamedDecl>(D)->getName().str()]++;
+	}
+
+	return names;
+}
+
 /* Is the name "name" used in any declaration other than "decl"?
  *
  * If the name was found to be in use before, the consider it to be in use.
+ * The same holds if it is declared or known to be in use
+ * in any of the PetScan objects into which the current function
+ * is being inlined.
  * Otherwise, check the DeclContext of the function containing the scop
  * as well as all ancestors of this DeclContext for declarations
  * other than "decl" that declare something called "name".
+ * The names declared in these DeclContexts are cached,
+ * along with the number of declarations of each name,
+ * such that this check does not need to consider
+ * all declarations in the DeclContexts each time.
  */
 bool PetScan::name_in_use(const string &name, Decl *decl)
 {
 	DeclContext *DC;
-	DeclContext::decl_iterator it;
+	PetScan *ps;
 
 	if (used_names.find(name) != used_names.end())
 		return true;
+	for (ps = outer; ps; ps = ps->outer) {
+		if (ps->declared_names.find(name) != ps->declared_names.end())
+			return true;
+		if (ps->used_names.find(name) != ps->used_names.end())
+			return true;
+	}
 
 	for (DC = decl_context; DC; DC = DC->getParent()) {
-		for (it = DC->decls_begin(); it != DC->decls_end(); ++it) {
-			Decl *D = *it;
-			NamedDecl *named;
-
-			if (D == decl)
-				continue;
-			if (!isa<NamedDecl>(D))
-				continue;
-			named = cast<NamedDecl>(D);
-			if (named->getName().str() == name)
-				return true;
-		}
+		PetDeclNames &names = get_decl_names(cache, DC);
+		std::map<std::string, int>::iterator it;
+		int n;
+
+		it = names.count.find(name);
+		if (it == names.count.end())
+			continue;
+		n = it->second;
+		if (decl && decl->getLexicalDeclContext() == DC &&
+		    isa<NamedDecl>(decl) &&
+		    cast<NamedDecl>(decl)->getName().str() == name)
+			--n;
+		if (n > 0)
+			return true;
 	}
 
 	return false;
@@ -1529,14 +1581,22 @@ bool PetScan::name_in_use(const string &name, Decl *decl)
 
 /* Generate a new name based on "name" that is not in use.
  * Do so by adding a suffix _i, with i an integer.
+ *
+ * The sequence numbers are kept per name in the outermost PetScan,
+ * such that each suffix of a given name is tried at most once,
+ * even if the same function is inlined many times.
  */
 string PetScan::generate_new_name(const string &name)
 {
 	string new_name;
+	PetScan *root;
 
+	for (root = this; root->outer; root = root->outer)
+		;
+	int &n = root->n_rename[name];
 	do {
 		std::ostringstream oss;
-		oss << name << "_" << n_rename++;
+		oss << name << "_" << n++;
 		new_name = oss.str();
 	} while (name_in_use(new_name, NULL));
 
@@ -1970,6 +2030,10 @@ int PetScan::substitute_array_sizes(__isl_keep pet_tree *tree,
  * that are declared in the calling function as well all variable
  * names that are known to be in use are considered to be in use
  * in the called function to ensure that there is no naming conflict.
+ * These names are looked up in the calling function through
+ * body_scan.outer rather than copied into the called function,
+ * since the latter would take time proportional to the number
+ * of names in use for each inlined call.
  * Similarly, the additional names that are in use in the called function
  * are considered to be in use in the calling function as well.
  *
@@ -1991,10 +2055,10 @@ __isl_give pet_tree *PetScan::extract_inlined_call(CallExpr *call,
 	save_autodetect = options->autodetect;
 	options->autodetect = 0;
 	PetScan body_scan(PP, ast_context, fd, loc, options,
-				isl_union_map_copy(value_bounds), independent);
+				isl_union_map_copy(value_bounds), independent,
+				cache);
 	collect_declared_names();
-	body_scan.add_new_used_names(declared_names);
-	body_scan.add_new_used_names(used_names);
+	body_scan.outer = this;
 	body_scan.return_root = fd->getBody();
 	tree = body_scan.extract(fd->getBody(), false);
 	add_new_used_names(body_scan.used_names);
@@ -2341,7 +2405,17 @@ static struct pet_array *extract_array(__isl_keep pet_expr *access,
  * array extents into maps.
  *
  * The result is stored in the summary_cache cache so that we can reuse
- * it if this method gets called on the same function again later on.
+ * it if this method gets called on the same function again later on,
+ * possibly from a different PetScan object.
+ * The summary does not depend on the PetScan object that computes it
+ * since it is extracted from the entire function body
+ * by a separate PetScan object.
+ * A failure due to the isl operation budget being exceeded
+ * is not cached since the extraction may be retried
+ * with a fresh budget.
+ * A summary extracted during such a retry, i.e., with dynamic control
+ * encapsulated, is only cached for use during other retries
+ * and is not written to the summary database.
  */
 __isl_give pet_function_summary *PetScan::get_summary(FunctionDecl *fd)
 {
@@ -2357,6 +2431,9 @@ __isl_give pet_function_summary *PetScan::get_summary(FunctionDecl *fd)
 	int int_size;
 	isl_union_set *may_read, *may_write, *must_write;
 	isl_union_map *to_inner;
+	std::map<FunctionDecl *, pet_function_summary *> &summary_cache =
+		cache.fallback ? cache.fallback_summary_cache :
+				 cache.summary_cache;
 
 	if (summary_cache.find(fd) != summary_cache.end())
 		return pet_function_summary_copy(summary_cache[fd]);
@@ -2382,7 +2459,8 @@ __isl_give pet_function_summary *PetScan::get_summary(FunctionDecl *fd)
 	save_autodetect = options->autodetect;
 	options->autodetect = 0;
 	PetScan body_scan(PP, ast_context, fd, loc, options,
-				isl_union_map_copy(value_bounds), independent);
+				isl_union_map_copy(value_bounds), independent,
+				cache);
 
 	body_scan.return_root = fd->getBody();
 	tree = body_scan.extract(fd->getBody(), false);
@@ -2393,7 +2471,7 @@ __isl_give pet_function_summary *PetScan::get_summary(FunctionDecl *fd)
 						&::get_array_size, &body_scan);
 	int_size = size_in_bytes(ast_context, ast_context.IntTy);
 	scop = pet_scop_from_pet_tree(tree, int_size,
-					&::extract_array, &body_scan, pc);
+					&::extract_array, &body_scan, pc, stats);
 	scop = scan_arrays(scop, pc);
 	may_read = isl_union_map_range(pet_scop_get_may_reads(scop));
 	may_write = isl_union_map_range(pet_scop_get_may_writes(scop));
@@ -2438,13 +2516,60 @@ __isl_give pet_function_summary *PetScan::get_summary(FunctionDecl *fd)
 	options->autodetect = save_autodetect;
 	pet_context_free(pc);
 
+	if (!summary && isl_ctx_last_error(ctx) == isl_error_quota)
+		return NULL;
 	summary_cache[fd] = pet_function_summary_copy(summary);
+	if (options->summaries && options->write_summaries && summary &&
+	    !cache.fallback)
+		pet_summary_db_store(options->summaries, fd, summary);
 
 	return summary;
 }
 
+/* Load a summary for the function declared by "fd", which does not
+ * have a body in this translation unit, from the summary database,
+ * if any.  Return NULL if no summary is available.
+ *
+ * The result (including a failure to find a summary) is cached
+ * in the summary_cache cache, keyed on the canonical declaration.
+ */
+__isl_give pet_function_summary *PetScan::load_summary(FunctionDecl *fd)
+{
+	std::map<FunctionDecl *, pet_function_summary *> &summary_cache =
+		cache.summary_cache;
+	pet_function_summary *summary;
+
+	if (!options->summaries)
+		return NULL;
+
+	fd = fd->getCanonicalDecl();
+	if (summary_cache.find(fd) != summary_cache.end())
+		return pet_function_summary_copy(summary_cache[fd]);
+
+	summary = pet_summary_db_load(ctx, options->summaries, fd);
+	summary_cache[fd] = pet_function_summary_copy(summary);
+
+	return summary;
+}
+
+/* Extract a summary from the body of "fd" and store it
+ * in the summary database.
+ * Since "fd" is not necessarily called from any scop,
+ * any diagnostics about the body are suppressed.
+ */
+void PetScan::store_summary(FunctionDecl *fd)
+{
+	DiagnosticsEngine &diag = PP.getDiagnostics();
+	bool suppress = diag.getSuppressAllDiagnostics();
+
+	diag.setSuppressAllDiagnostics(true);
+	pet_function_summary_free(get_summary(fd));
+	diag.setSuppressAllDiagnostics(suppress);
+}
+
 /* If "fd" has a function body, then extract a function summary from
  * this body and attach it to the call expression "expr".
+ * Otherwise, attach the summary from the summary database, if any.
  *
  * Even if a function body is available, "fd" itself may point
  * to a declaration without function body.  We therefore first
@@ -2454,14 +2579,18 @@ __isl_give pet_expr *PetScan::set_summary(__isl_take pet_expr *expr,
 	FunctionDecl *fd)
 {
 	pet_function_summary *summary;
+	FunctionDecl *def;
 
 	if (!expr)
 		return NULL;
-	fd = pet_clang_find_function_decl_with_body(fd);
-	if (!fd)
-		return expr;
-
-	summary = get_summary(fd);
+	def = pet_clang_find_function_decl_with_body(fd);
+	if (def) {
+		summary = get_summary(def);
+	} else {
+		summary = load_summary(fd);
+		if (!summary)
+			return expr;
+	}
 
 	expr = pet_expr_call_set_summary(expr, summary);
 
@@ -2487,10 +2616,18 @@ struct pet_scop *PetScan::extract_scop(__isl_take pet_tree *tree)
 
 	domain = isl_set_universe(isl_space_set_alloc(ctx, 0, 0));
 	pc = pet_context_alloc(domain);
-	pc = pet_context_add_parameters(pc, tree, &::get_array_size, this);
-	scop = pet_scop_from_pet_tree(tree, int_size,
-					&::extract_array, this, pc);
-	scop = scan_arrays(scop, pc);
+	{
+		pet_stats_phase phase(stats, "scop");
+		pc = pet_context_add_parameters(pc, tree,
+						&::get_array_size, this);
+		scop = pet_scop_from_pet_tree(tree, int_size,
+						&::extract_array, this, pc,
+						stats);
+	}
+	{
+		pet_stats_phase phase(stats, "arrays");
+		scop = scan_arrays(scop, pc);
+	}
 	pet_context_free(pc);
 
 	return scop;
@@ -2742,7 +2879,11 @@ __isl_give pet_expr *PetScan::set_upper_bounds(__isl_take pet_expr *expr,
  * The result is stored in the id_size cache so that it can be reused
  * if this method is called on the same array identifier later.
  * The result is also stored in the type_size cache in case
- * it gets called on a different array identifier with the same type.
+ * it gets called on a different array identifier with the same type,
+ * possibly from a different PetScan object.
+ * Any substitutions performed by substitute_array_sizes
+ * only affect the id_size cache.
+ * Failures are not cached.
  */
 __isl_give pet_expr *PetScan::get_array_size(__isl_keep isl_id *id)
 {
@@ -2751,6 +2892,7 @@ __isl_give pet_expr *PetScan::get_array_size(__isl_keep isl_id *id)
 	pet_expr *expr, *inf;
 	const Type *type = qt.getTypePtr();
 	isl_maybe_pet_expr m;
+	std::map<const Type *, pet_expr *> &type_size = cache.type_size;
 
 	m = isl_id_to_pet_expr_try_get(id_size, id);
 	if (m.valid < 0 || m.valid)
@@ -2766,6 +2908,8 @@ __isl_give pet_expr *PetScan::get_array_size(__isl_keep isl_id *id)
 	pet_expr_free(inf);
 
 	expr = set_upper_bounds(expr, qt, 0);
+	if (!expr)
+		return NULL;
 	type_size[type] = pet_expr_copy(expr);
 	id_size = isl_id_to_pet_expr_set(id_size, isl_id_copy(id),
 					pet_expr_copy(expr));
@@ -2892,21 +3036,13 @@ static void insert_intermediate_typedefs(PetTypes *types, QualType type)
  * based on the type of the variable.  The upper bounds are converted
  * to affine expressions within the context "pc".
  *
- * If the base type is that of a record with a top-level definition or
- * of a typedef and if "types" is not null, then the RecordDecl or
- * TypedefType corresponding to the type, as well as any intermediate
- * TypedefType, is added to "types".
- *
- * If the base type is that of a record with no top-level definition,
- * then we replace it by "<subfield>".
- *
  * If the variable is a scalar, i.e., a zero-dimensional array,
  * then the "const" qualifier, if any, is removed from the base type.
  * This makes it easier for users of pet to turn initializations
  * into assignments.
  */
-struct pet_array *PetScan::extract_array(__isl_keep isl_id *id,
-	PetTypes *types, __isl_keep pet_context *pc)
+struct pet_array *PetScan::construct_array(__isl_keep isl_id *id,
+	__isl_keep pet_context *pc)
 {
 	struct pet_array *array;
 	QualType qt = pet_id_get_array_type(id);
@@ -2935,27 +3071,130 @@ struct pet_array *PetScan::extract_array(__isl_keep isl_id *id,
 		base.removeLocalConst();
 	name = base.getAsString();
 
-	if (types) {
-		insert_intermediate_typedefs(types, qt);
-		if (isa<TypedefType>(base)) {
-			types->insert(cast<TypedefType>(base)->getDecl());
-		} else if (base->isRecordType()) {
-			RecordDecl *decl = pet_clang_record_decl(base);
-			TypedefNameDecl *typedecl;
-			typedecl = decl->getTypedefNameForAnonDecl();
-			if (typedecl)
-				types->insert(typedecl);
-			else if (has_printable_definition(decl))
-				types->insert(decl);
-			else
-				name = "<subfield>";
-		}
-	}
-
 	array->element_type = strdup(name.c_str());
 	array->element_is_record = base->isRecordType();
 	array->element_size = size_in_bytes(ast_context, base);
 
+	if (!array->element_type)
+		return pet_array_free(array);
+
+	return array;
+}
+
+/* Is the pet_array corresponding to the variable represented by "id"
+ * independent of the scop in which it appears?
+ *
+ * The size expressions of file scope variables and of fields
+ * are not affected by substitute_array_sizes and
+ * they are integer constants, such that they do not depend
+ * on the context in which they are converted to affine expressions.
+ * Double-check the latter since set_upper_bounds only takes
+ * into account the size expressions that it manages to convert.
+ */
+static bool is_shared_array(PetScan *ps, __isl_keep isl_id *id)
+{
+	ValueDecl *decl;
+	VarDecl *var;
+	pet_expr *size;
+	int n;
+	bool shared = true;
+
+	decl = pet_id_get_decl(id);
+	if (!decl)
+		return false;
+	var = dyn_cast<VarDecl>(decl);
+	if (!isa<FieldDecl>(decl) && !(var && var->isFileVarDecl()))
+		return false;
+
+	size = ps->get_array_size(id);
+	n = pet_expr_get_n_arg(size);
+	for (int i = 0; i < n; ++i) {
+		pet_expr *arg;
+
+		arg = pet_expr_get_arg(size, i);
+		if (pet_expr_get_type(arg) != pet_expr_int)
+			shared = false;
+		pet_expr_free(arg);
+	}
+	pet_expr_free(size);
+
+	return n >= 0 && shared;
+}
+
+/* Add the RecordDecl or TypedefType corresponding to the base type "base"
+ * of the array type "qt", as well as any intermediate TypedefType,
+ * to "types", provided the base type is that of a record
+ * with a top-level definition or of a typedef.
+ * Return false if the base type is that of a record
+ * with no top-level definition.
+ */
+static bool insert_types(PetTypes *types, QualType qt, QualType base)
+{
+	insert_intermediate_typedefs(types, qt);
+	if (isa<TypedefType>(base)) {
+		types->insert(cast<TypedefType>(base)->getDecl());
+	} else if (base->isRecordType()) {
+		RecordDecl *decl = pet_clang_record_decl(base);
+		TypedefNameDecl *typedecl;
+		typedecl = decl->getTypedefNameForAnonDecl();
+		if (typedecl)
+			types->insert(typedecl);
+		else if (has_printable_definition(decl))
+			types->insert(decl);
+		else
+			return false;
+	}
+
+	return true;
+}
+
+/* Construct and return a pet_array corresponding to the variable
+ * represented by "id", with the upper bounds converted
+ * to affine expressions within the context "pc".
+ *
+ * If the pet_array does not depend on the scop in which it appears,
+ * then it is only constructed once per translation unit and
+ * a copy of the cached pet_array is returned on subsequent calls.
+ * Global arrays typically appear in many scops of the same
+ * translation unit.
+ *
+ * If the base type is that of a record with a top-level definition or
+ * of a typedef and if "types" is not null, then the RecordDecl or
+ * TypedefType corresponding to the type, as well as any intermediate
+ * TypedefType, is added to "types".
+ *
+ * If the base type is that of a record with no top-level definition,
+ * then we replace it by "<subfield>".
+ */
+struct pet_array *PetScan::extract_array(__isl_keep isl_id *id,
+	PetTypes *types, __isl_keep pet_context *pc)
+{
+	struct pet_array *array;
+	QualType qt = pet_id_get_array_type(id);
+	QualType base = pet_clang_base_type(qt);
+	std::map<isl_id *, pet_array *>::iterator it;
+
+	it = cache.arrays.find(id);
+	if (it != cache.arrays.end()) {
+		array = pet_array_dup(it->second);
+	} else {
+		array = construct_array(id, pc);
+		if (array && is_shared_array(this, id)) {
+			pet_array *dup = pet_array_dup(array);
+			if (dup)
+				cache.arrays[isl_id_copy(id)] = dup;
+		}
+	}
+	if (!array)
+		return NULL;
+
+	if (types && !insert_types(types, qt, base)) {
+		free(array->element_type);
+		array->element_type = strdup("<subfield>");
+		if (!array->element_type)
+			return pet_array_free(array);
+	}
+
 	return array;
 }
 
@@ -3090,14 +3329,14 @@ static struct pet_scop *add_type(isl_ctx *ctx, struct pet_scop *scop,
 	string s;
 	llvm::raw_string_ostream S(s);
 
-	if (types.records.find(decl) == types.records.end())
+	if (!types.contains(decl))
 		return scop;
 	if (types_done.find(decl) != types_done.end())
 		return scop;
 
 	add_field_types(ctx, scop, decl, PP, types, types_done);
 
-	if (strlen(decl->getName().str().c_str()) == 0)
+	if (decl->getName().empty())
 		return scop;
 
 	decl->print(S, PrintingPolicy(PP.getLangOpts()));
@@ -3135,7 +3374,7 @@ static struct pet_scop *add_type(isl_ctx *ctx, struct pet_scop *scop,
 	llvm::raw_string_ostream S(s);
 	QualType qt = decl->getUnderlyingType();
 
-	if (types.typedefs.find(decl) == types.typedefs.end())
+	if (!types.contains(decl))
 		return scop;
 	if (types_done.find(decl) != types_done.end())
 		return scop;
@@ -3199,8 +3438,8 @@ struct pet_scop *PetScan::scan_arrays(struct pet_scop *scop,
 	array_desc_set::iterator it;
 	PetTypes types;
 	std::set<TypeDecl *> types_done;
-	std::set<clang::RecordDecl *, less_name>::iterator records_it;
-	std::set<clang::TypedefNameDecl *, less_name>::iterator typedefs_it;
+	PetTypes::record_map::iterator records_it;
+	PetTypes::typedef_map::iterator typedefs_it;
 	int n_array;
 	struct pet_array **scop_arrays;
 
@@ -3251,11 +3490,13 @@ struct pet_scop *PetScan::scan_arrays(struct pet_scop *scop,
 
 	for (typedefs_it = types.typedefs.begin();
 	     typedefs_it != types.typedefs.end(); ++typedefs_it)
-		scop = add_type(ctx, scop, *typedefs_it, PP, types, types_done);
+		scop = add_type(ctx, scop, typedefs_it->second,
+				PP, types, types_done);
 
 	for (records_it = types.records.begin();
 	     records_it != types.records.end(); ++records_it)
-		scop = add_type(ctx, scop, *records_it, PP, types, types_done);
+		scop = add_type(ctx, scop, records_it->second,
+				PP, types, types_done);
 
 	return scop;
 error:
@@ -3320,6 +3561,7 @@ struct pet_scop *PetScan::scan(FunctionDecl *fd)
 		scop = scan(stmt);
 		scop = pet_scop_update_start_end(scop, loc.start, loc.end);
 	}
+	pet_stats_phase phase(stats, "gist");
 	scop = add_parameter_bounds(scop);
 	scop = pet_scop_gist(scop, value_bounds);
 
@@ -8,6 +8,7 @@
 #include <clang/AST/Decl.h>
 #include <clang/AST/Stmt.h>
 #include <clang/Lex/Preprocessor.h>
+#include <llvm/ADT/StringRef.h>
 
 #include <isl/ctx.h>
 #include <isl/map.h>
@@ -67,32 +68,91 @@ struct Independent {
 	unsigned line;
 };
 
-/* Compare two TypeDecl pointers based on their names.
- */
-struct less_name {
-	bool operator()(const clang::TypeDecl *x,
-			const clang::TypeDecl *y) {
-		return x->getNameAsString().compare(y->getNameAsString()) < 0;
-	}
-};
-
 /* The PetTypes structure collects a set of RecordDecl and
  * TypedefNameDecl pointers.
  * The pointers are sorted using a fixed order.  The actual order
  * is not important, only that it is consistent across platforms.
+ * In particular, the pointers are keyed on their names, which
+ * point into the identifier table of the clang::ASTContext, so that
+ * neither an insertion nor a lookup needs to construct a string.
+ * Only the first declaration with a given name is kept.
  */
 struct PetTypes {
-	std::set<clang::RecordDecl *, less_name> records;
-	std::set<clang::TypedefNameDecl *, less_name> typedefs;
+	typedef std::map<llvm::StringRef, clang::RecordDecl *> record_map;
+	typedef std::map<llvm::StringRef, clang::TypedefNameDecl *>
+								typedef_map;
+
+	record_map records;
+	typedef_map typedefs;
 
 	void insert(clang::RecordDecl *decl) {
-		records.insert(decl);
+		records.insert(std::make_pair(decl->getName(), decl));
 	}
 	void insert(clang::TypedefNameDecl *decl) {
-		typedefs.insert(decl);
+		typedefs.insert(std::make_pair(decl->getName(), decl));
+	}
+	bool contains(clang::RecordDecl *decl) const {
+		return records.find(decl->getName()) != records.end();
+	}
+	bool contains(clang::TypedefNameDecl *decl) const {
+		return typedefs.find(decl->getName()) != typedefs.end();
 	}
 };
 
+/* The names declared in a DeclContext, along with the number
+ * of declarations of each name.
+ * "last" is the last declaration in the DeclContext that has been
+ * taken into account, such that declarations that are added
+ * to the DeclContext later on can be added incrementally.
+ */
+struct PetDeclNames {
+	std::map<std::string, int> count;
+	clang::Decl *last;
+
+	PetDeclNames() : last(NULL) {}
+};
+
+/* Caches of information that only depends on the translation unit
+ * and that can therefore be shared by all PetScan objects
+ * operating on the same translation unit.
+ *
+ * "type_size" caches size expressions for array types as computed
+ * by PetScan::get_array_size.
+ * "summary_cache" caches function summaries for function declarations
+ * as extracted by PetScan::get_summary.
+ * If "fallback" is set, then scops are being extracted again
+ * with dynamic control encapsulated because the isl operation budget
+ * was exceeded.  The function summaries extracted in this mode
+ * are coarser than the regular ones.  They are therefore kept
+ * in "fallback_summary_cache" instead and they are not written
+ * to the summary database.
+ * "decl_names" caches the names declared in DeclContexts
+ * as used by PetScan::name_in_use.
+ * "arrays" caches the pet_arrays extracted by PetScan::extract_array
+ * for array identifiers that do not depend on the scop in which
+ * they appear, i.e., file scope variables and fields.
+ * The element type of these pet_arrays is the full name of
+ * the base type.
+ *
+ * The caches hold a reference to each of their elements,
+ * which is released when the PetScanCache is destroyed.
+ */
+struct PetScanCache {
+	std::map<const clang::Type *, pet_expr *> type_size;
+	std::map<clang::FunctionDecl *, pet_function_summary *> summary_cache;
+	bool fallback;
+	std::map<clang::FunctionDecl *, pet_function_summary *>
+		fallback_summary_cache;
+	std::map<clang::DeclContext *, PetDeclNames> decl_names;
+	std::map<isl_id *, pet_array *> arrays;
+
+	PetScanCache() : fallback(false) {}
+	~PetScanCache();
+private:
+	PetScanCache(const PetScanCache &);
+	PetScanCache &operator=(const PetScanCache &);
+};
+
 struct PetScan {
 	clang::Preprocessor &PP;
 	clang::ASTContext &ast_context;
@@ -119,15 +179,11 @@ struct PetScan {
 	 * by PetScan::get_array_size, or set by PetScan::set_array_size.
 	 */
 	isl_id_to_pet_expr *id_size;
-	/* A cache of size expressions for array types as computed
-	 * by PetScan::get_array_size.
+	/* Caches of size expressions for array types and
+	 * of function summaries, shared by all PetScan objects
+	 * operating on the same translation unit.
 	 */
-	std::map<const clang::Type *, pet_expr *> type_size;
-
-	/* A cache of funtion summaries for function declarations
-	 * as extracted by PetScan::get_summary.
-	 */
-	std::map<clang::FunctionDecl *, pet_function_summary *> summary_cache;
+	PetScanCache &cache;
 
 	/* A union of mappings of the form
 	 *	{ identifier[] -> [i] : lower_bound <= i <= upper_bound }
@@ -145,8 +201,11 @@ struct PetScan {
 	 * in the current compound statement.
 	 */
 	std::vector<clang::VarDecl *> declarations;
-	/* Sequence number of the next rename. */
-	int n_rename;
+	/* Sequence number of the next rename of each name.
+	 * Only used in the outermost PetScan, i.e., the one without "outer",
+	 * such that the functions inlined into it share the same numbers.
+	 */
+	std::map<std::string, int> n_rename;
 	/* Have the declared names been collected? */
 	bool declared_names_collected;
 	/* The names of the variables declared in decl_context,
@@ -155,6 +214,12 @@ struct PetScan {
 	std::set<std::string> declared_names;
 	/* A set of names known to be in use. */
 	std::set<std::string> used_names;
+	/* If not NULL, the PetScan of the function into which
+	 * the function of this PetScan is being inlined.
+	 * The names that are declared or known to be in use in "outer"
+	 * are also considered to be in use in this PetScan.
+	 */
+	PetScan *outer;
 
 	/* If not NULL, then "call2id" maps inlined call expressions
 	 * that return a value to the corresponding variables.
@@ -166,24 +231,31 @@ struct PetScan {
 	/* Sequence number of the next temporary inlined return variable. */
 	int n_ret;
 
+	/* If not NULL, the statistics in which the time spent
+	 * in the different phases of scan is recorded.
+	 */
+	pet_stats *stats;
+
 	PetScan(clang::Preprocessor &PP, clang::ASTContext &ast_context,
 		clang::DeclContext *decl_context, ScopLoc &loc,
 		pet_options *options, __isl_take isl_union_map *value_bounds,
-		std::vector<Independent> &independent) :
+		std::vector<Independent> &independent, PetScanCache &cache) :
 		PP(PP),
 		ast_context(ast_context), decl_context(decl_context), loc(loc),
 		ctx(isl_union_map_get_ctx(value_bounds)),
 		options(options), return_root(NULL), partial(false),
+		cache(cache),
 		value_bounds(value_bounds), last_line(0), current_line(0),
-		independent(independent), n_rename(0),
-		declared_names_collected(false), call2id(NULL),
-		n_arg(0), n_ret(0) {
+		independent(independent),
+		declared_names_collected(false), outer(NULL), call2id(NULL),
+		n_arg(0), n_ret(0), stats(NULL) {
 		id_size = isl_id_to_pet_expr_alloc(ctx, 0);
 	}
 
 	~PetScan();
 
 	struct pet_scop *scan(clang::FunctionDecl *fd);
+	void store_summary(clang::FunctionDecl *fd);
 
 	static __isl_give isl_val *extract_int(isl_ctx *ctx,
 		clang::IntegerLiteral *expr);
@@ -195,6 +267,8 @@ struct PetScan {
 		clang::FunctionDecl *fd, __isl_keep isl_id *return_id);
 private:
 	void set_current_stmt(clang::Stmt *stmt);
+	struct pet_array *construct_array(__isl_keep isl_id *id,
+		__isl_keep pet_context *pc);
 	bool is_current_stmt_marked_independent();
 
 	void collect_declared_names();
@@ -267,6 +341,7 @@ private:
 
 	__isl_give pet_expr *extract_assume(clang::Expr *expr);
 	__isl_give pet_function_summary *get_summary(clang::FunctionDecl *fd);
+	__isl_give pet_function_summary *load_summary(clang::FunctionDecl *fd);
 	__isl_give pet_expr *set_summary(__isl_take pet_expr *expr,
 		clang::FunctionDecl *fd);
 	__isl_give pet_expr *extract_argument(clang::FunctionDecl *fd, int pos,
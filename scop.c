@@ -246,6 +246,42 @@ struct pet_array *pet_array_free(struct pet_array *array)
 	return NULL;
 }
 
+/* Return a copy of "array".
+ */
+struct pet_array *pet_array_dup(struct pet_array *array)
+{
+	isl_ctx *ctx;
+	struct pet_array *dup;
+
+	if (!array)
+		return NULL;
+
+	ctx = isl_set_get_ctx(array->extent);
+	dup = isl_calloc_type(ctx, struct pet_array);
+	if (!dup)
+		return NULL;
+
+	dup->context = isl_set_copy(array->context);
+	dup->extent = isl_set_copy(array->extent);
+	dup->value_bounds = isl_set_copy(array->value_bounds);
+	dup->element_type = array->element_type ?
+				strdup(array->element_type) : NULL;
+	dup->element_is_record = array->element_is_record;
+	dup->element_size = array->element_size;
+	dup->live_out = array->live_out;
+	dup->uniquely_defined = array->uniquely_defined;
+	dup->declared = array->declared;
+	dup->exposed = array->exposed;
+	dup->outer = array->outer;
+
+	if (!dup->context || !dup->extent ||
+	    (array->value_bounds && !dup->value_bounds) ||
+	    (array->element_type && !dup->element_type))
+		return pet_array_free(dup);
+
+	return dup;
+}
+
 void pet_array_dump(struct pet_array *array)
 {
 	if (!array)
@@ -1039,6 +1075,260 @@ error:
 	return NULL;
 }
 
+/* Does "scop" have any skip conditions?
+ */
+static int scop_has_skips(struct pet_scop *scop)
+{
+	struct pet_scop_ext *ext = (struct pet_scop_ext *) scop;
+
+	return ext->skip[pet_skip_now] || ext->skip[pet_skip_later];
+}
+
+/* Return the sequence of the schedules of the "n" pet_scops
+ * starting at "scops".
+ * The sequence is constructed by recursively combining the two halves
+ * such that each schedule is only involved in a logarithmic number
+ * of calls to isl_schedule_sequence.
+ * Since isl_schedule_sequence flattens nested sequences,
+ * the result is the same as that of combining the schedules
+ * one by one.
+ */
+static __isl_give isl_schedule *schedule_sequence(struct pet_scop **scops,
+	int n)
+{
+	int half;
+
+	if (n == 1)
+		return isl_schedule_copy(scops[0]->schedule);
+	half = n / 2;
+	return isl_schedule_sequence(schedule_sequence(scops, half),
+				schedule_sequence(scops + half, n - half));
+}
+
+/* Construct a pet_scop that contains the arrays, statements and
+ * other information in the "n" pet_scops in "scops", executed
+ * in sequence, freeing the input pet_scops.
+ * None of the pet_scops is allowed to have any skip conditions.
+ *
+ * The result is the same as that of combining the pet_scops one by one
+ * using pet_scop_add_seq, but the result is constructed in one go,
+ * rather than constructing every intermediate result, which
+ * would take time quadratic in the number of statements.
+ * In particular, pet_scops without statements are dropped
+ * (and the last one is returned if they all lack statements),
+ * the contexts are intersected, the offset information is combined and
+ * the implications of each pet_scop that are not already present
+ * in one of the earlier pet_scops are added.
+ */
+static struct pet_scop *scop_add_seq_n(isl_ctx *ctx, int n,
+	struct pet_scop **scops)
+{
+	int i, j, k, n_scop;
+	int n_stmt = 0, n_array = 0, n_implication = 0, n_independence = 0;
+	isl_space *space;
+	struct pet_scop *scop = NULL;
+
+	for (i = 0; i < n; ++i)
+		if (!scops[i])
+			goto error;
+
+	n_scop = 0;
+	for (i = 0; i < n; ++i) {
+		if (scops[i]->n_stmt == 0 && (n_scop > 0 || i < n - 1)) {
+			scops[i] = pet_scop_free(scops[i]);
+			continue;
+		}
+		scops[n_scop++] = scops[i];
+	}
+	n = n_scop;
+	if (n == 1)
+		return scops[0];
+
+	for (i = 0; i < n; ++i) {
+		n_stmt += scops[i]->n_stmt;
+		n_array += scops[i]->n_array;
+		n_implication += scops[i]->n_implication;
+		n_independence += scops[i]->n_independence;
+	}
+
+	space = isl_set_get_space(scops[0]->context);
+	scop = scop_alloc(space, n_stmt, schedule_sequence(scops, n));
+	if (!scop)
+		goto error;
+
+	scop->arrays = isl_calloc_array(ctx, struct pet_array *, n_array);
+	if (n_array && !scop->arrays)
+		goto error;
+	if (n_implication) {
+		scop->implications = isl_calloc_array(ctx,
+				struct pet_implication *, n_implication);
+		if (!scop->implications)
+			goto error;
+	}
+	if (n_independence) {
+		scop->independences = isl_calloc_array(ctx,
+				struct pet_independence *, n_independence);
+		if (!scop->independences)
+			goto error;
+	}
+
+	j = 0;
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < scops[i]->n_stmt; ++k) {
+			scop->stmts[j++] = scops[i]->stmts[k];
+			scops[i]->stmts[k] = NULL;
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < scops[i]->n_array; ++k) {
+			scop->arrays[scop->n_array++] = scops[i]->arrays[k];
+			scops[i]->arrays[k] = NULL;
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		j = scop->n_implication;
+		for (k = 0; k < scops[i]->n_implication; ++k) {
+			struct pet_implication *implication;
+			int known;
+
+			implication = scops[i]->implications[k];
+			known = is_known_implication(scop, implication);
+			if (known < 0) {
+				scop->n_implication = j;
+				goto error;
+			}
+			if (known)
+				continue;
+			scop->implications[j++] = implication;
+			scops[i]->implications[k] = NULL;
+		}
+		scop->n_implication = j;
+	}
+	for (i = 0; i < n; ++i) {
+		for (k = 0; k < scops[i]->n_independence; ++k) {
+			scop->independences[scop->n_independence++] =
+				scops[i]->independences[k];
+			scops[i]->independences[k] = NULL;
+		}
+	}
+	for (i = 0; i < n; ++i) {
+		scop = pet_scop_restrict_context(scop,
+					isl_set_copy(scops[i]->context));
+		if (scops[i]->loc != &pet_loc_dummy)
+			scop = pet_scop_update_start_end_from_loc(scop,
+							scops[i]->loc);
+	}
+
+	for (i = 0; i < n; ++i)
+		pet_scop_free(scops[i]);
+	return scop;
+error:
+	for (i = 0; i < n; ++i)
+		pet_scop_free(scops[i]);
+	pet_scop_free(scop);
+	return NULL;
+}
+
+/* Initialize "seq" to an empty sequence of pet_scops in "ctx".
+ */
+void pet_scop_seq_init(struct pet_scop_seq *seq, isl_ctx *ctx)
+{
+	seq->ctx = ctx;
+	seq->n = 0;
+	seq->size = 0;
+	seq->scops = NULL;
+}
+
+/* Free all pet_scops in "seq" and reset it to an empty sequence.
+ */
+void pet_scop_seq_clear(struct pet_scop_seq *seq)
+{
+	int i;
+
+	for (i = 0; i < seq->n; ++i)
+		pet_scop_free(seq->scops[i]);
+	free(seq->scops);
+	pet_scop_seq_init(seq, seq->ctx);
+}
+
+/* Combine "scop" with the pet_scops collected in "seq", in sequence,
+ * and return the result, leaving "seq" empty.
+ * "scop" is placed before the pet_scops in "seq".
+ */
+struct pet_scop *pet_scop_seq_flush(struct pet_scop_seq *seq,
+	struct pet_scop *scop)
+{
+	struct pet_scop **scops;
+
+	if (!scop || seq->n == 0) {
+		pet_scop_seq_clear(seq);
+		return scop;
+	}
+
+	scops = isl_alloc_array(seq->ctx, struct pet_scop *, seq->n + 1);
+	if (!scops)
+		goto error;
+	scops[0] = scop;
+	memcpy(scops + 1, seq->scops, seq->n * sizeof(*scops));
+	scop = scop_add_seq_n(seq->ctx, seq->n + 1, scops);
+	free(scops);
+	free(seq->scops);
+	pet_scop_seq_init(seq, seq->ctx);
+
+	return scop;
+error:
+	pet_scop_free(scop);
+	pet_scop_seq_clear(seq);
+	return NULL;
+}
+
+/* Add "scop2" in sequence to the combination of "scop1" with
+ * the pet_scops collected in "seq", i.e., perform the equivalent of
+ * pet_scop_add_seq on this combination and "scop2", and
+ * return the pet_scop that should be used in place of "scop1"
+ * in the next call.
+ *
+ * If none of "scop1" and "scop2" has any skip conditions,
+ * then "scop2" simply gets added to "seq", postponing the actual
+ * combination until pet_scop_seq_flush is called.
+ * Since the pet_scops in "seq" do not have any skip conditions either,
+ * the skip conditions of the returned pet_scop (i.e., "scop1")
+ * are those of the combination.
+ * Otherwise, the combination is constructed immediately.
+ */
+struct pet_scop *pet_scop_seq_add(struct pet_scop_seq *seq,
+	struct pet_scop *scop1, struct pet_scop *scop2)
+{
+	struct pet_scop **scops;
+
+	if (!scop1 || !scop2)
+		goto error;
+
+	if (scop_has_skips(scop1) || scop_has_skips(scop2)) {
+		scop1 = pet_scop_seq_flush(seq, scop1);
+		return pet_scop_add_seq(seq->ctx, scop1, scop2);
+	}
+
+	if (seq->n >= seq->size) {
+		int size = 2 * seq->size + 16;
+
+		scops = isl_realloc_array(seq->ctx, seq->scops,
+					struct pet_scop *, size);
+		if (!scops)
+			goto error;
+		seq->scops = scops;
+		seq->size = size;
+	}
+	seq->scops[seq->n++] = scop2;
+
+	return scop1;
+error:
+	pet_scop_free(scop1);
+	pet_scop_free(scop2);
+	pet_scop_seq_clear(seq);
+	return NULL;
+}
+
 /* Construct a pet_scop that contains the arrays, statements and
  * skip information in "scop1" and "scop2", where the two scops
  * are executed "in parallel".  That is, any break or continue
@@ -1122,6 +1412,325 @@ struct pet_scop *pet_scop_free(struct pet_scop *scop)
 	return NULL;
 }
 
+/* Return a copy of "stmt".
+ */
+static struct pet_stmt *pet_stmt_dup(struct pet_stmt *stmt)
+{
+	int i;
+	isl_ctx *ctx;
+	struct pet_stmt *dup;
+
+	if (!stmt)
+		return NULL;
+
+	ctx = isl_set_get_ctx(stmt->domain);
+	dup = isl_calloc_type(ctx, struct pet_stmt);
+	if (!dup)
+		return NULL;
+
+	dup->loc = pet_loc_copy(stmt->loc);
+	dup->domain = isl_set_copy(stmt->domain);
+	dup->body = pet_tree_copy(stmt->body);
+	if (stmt->n_arg > 0) {
+		dup->args = isl_calloc_array(ctx, pet_expr *, stmt->n_arg);
+		if (!dup->args)
+			return pet_stmt_free(dup);
+	}
+	dup->n_arg = stmt->n_arg;
+	for (i = 0; i < stmt->n_arg; ++i) {
+		dup->args[i] = pet_expr_copy(stmt->args[i]);
+		if (!dup->args[i])
+			return pet_stmt_free(dup);
+	}
+
+	if (!dup->loc || !dup->domain || !dup->body)
+		return pet_stmt_free(dup);
+
+	return dup;
+}
+
+/* Return a copy of "implication".
+ */
+static struct pet_implication *pet_implication_dup(
+	struct pet_implication *implication)
+{
+	isl_ctx *ctx;
+	struct pet_implication *dup;
+
+	if (!implication)
+		return NULL;
+
+	ctx = isl_map_get_ctx(implication->extension);
+	dup = isl_alloc_type(ctx, struct pet_implication);
+	if (!dup)
+		return NULL;
+
+	dup->satisfied = implication->satisfied;
+	dup->extension = isl_map_copy(implication->extension);
+
+	if (!dup->extension)
+		return pet_implication_free(dup);
+
+	return dup;
+}
+
+/* Return a copy of "independence".
+ */
+static struct pet_independence *pet_independence_dup(
+	struct pet_independence *independence)
+{
+	isl_ctx *ctx;
+	struct pet_independence *dup;
+
+	if (!independence)
+		return NULL;
+
+	ctx = isl_union_map_get_ctx(independence->filter);
+	dup = isl_alloc_type(ctx, struct pet_independence);
+	if (!dup)
+		return NULL;
+
+	dup->filter = isl_union_map_copy(independence->filter);
+	dup->local = isl_union_set_copy(independence->local);
+
+	if (!dup->filter || !dup->local)
+		return pet_independence_free(dup);
+
+	return dup;
+}
+
+/* Return a copy of "scop".
+ * The copy shares the reference counted objects with "scop".
+ */
+struct pet_scop *pet_scop_dup(struct pet_scop *scop)
+{
+	int i;
+	isl_ctx *ctx;
+	struct pet_scop *dup;
+	struct pet_scop_ext *ext, *dup_ext;
+
+	if (!scop)
+		return NULL;
+
+	ctx = isl_set_get_ctx(scop->context);
+	dup = pet_scop_alloc(ctx);
+	if (!dup)
+		return NULL;
+
+	dup->loc = pet_loc_copy(scop->loc);
+	dup->context = isl_set_copy(scop->context);
+	dup->context_value = isl_set_copy(scop->context_value);
+	dup->schedule = isl_schedule_copy(scop->schedule);
+	ext = (struct pet_scop_ext *) scop;
+	dup_ext = (struct pet_scop_ext *) dup;
+	dup_ext->skip[pet_skip_now] =
+		isl_multi_pw_aff_copy(ext->skip[pet_skip_now]);
+	dup_ext->skip[pet_skip_later] =
+		isl_multi_pw_aff_copy(ext->skip[pet_skip_later]);
+	dup_ext->input = ext->input;
+	if (!dup->loc || !dup->context || !dup->context_value ||
+	    !dup->schedule)
+		return pet_scop_free(dup);
+
+	if (scop->n_type > 0) {
+		dup->types = isl_calloc_array(ctx, struct pet_type *,
+						scop->n_type);
+		if (!dup->types)
+			return pet_scop_free(dup);
+	}
+	for (i = 0; i < scop->n_type; ++i) {
+		dup->types[i] = pet_type_alloc(ctx, scop->types[i]->name,
+						scop->types[i]->definition);
+		if (!dup->types[i])
+			return pet_scop_free(dup);
+		dup->n_type++;
+	}
+
+	if (scop->n_array > 0) {
+		dup->arrays = isl_calloc_array(ctx, struct pet_array *,
+						scop->n_array);
+		if (!dup->arrays)
+			return pet_scop_free(dup);
+	}
+	for (i = 0; i < scop->n_array; ++i) {
+		dup->arrays[i] = pet_array_dup(scop->arrays[i]);
+		if (!dup->arrays[i])
+			return pet_scop_free(dup);
+		dup->n_array++;
+	}
+
+	if (scop->n_stmt > 0) {
+		dup->stmts = isl_calloc_array(ctx, struct pet_stmt *,
+						scop->n_stmt);
+		if (!dup->stmts)
+			return pet_scop_free(dup);
+	}
+	for (i = 0; i < scop->n_stmt; ++i) {
+		dup->stmts[i] = pet_stmt_dup(scop->stmts[i]);
+		if (!dup->stmts[i])
+			return pet_scop_free(dup);
+		dup->n_stmt++;
+	}
+
+	if (scop->n_implication > 0) {
+		dup->implications = isl_calloc_array(ctx,
+				struct pet_implication *, scop->n_implication);
+		if (!dup->implications)
+			return pet_scop_free(dup);
+	}
+	for (i = 0; i < scop->n_implication; ++i) {
+		dup->implications[i] =
+			pet_implication_dup(scop->implications[i]);
+		if (!dup->implications[i])
+			return pet_scop_free(dup);
+		dup->n_implication++;
+	}
+
+	if (scop->n_independence > 0) {
+		dup->independences = isl_calloc_array(ctx,
+			struct pet_independence *, scop->n_independence);
+		if (!dup->independences)
+			return pet_scop_free(dup);
+	}
+	for (i = 0; i < scop->n_independence; ++i) {
+		dup->independences[i] =
+			pet_independence_dup(scop->independences[i]);
+		if (!dup->independences[i])
+			return pet_scop_free(dup);
+		dup->n_independence++;
+	}
+
+	return dup;
+}
+
+/* Move all locations in "scop" by "offset" bytes and "line" lines,
+ * e.g., because the code from which "scop" was extracted
+ * has moved in the input.
+ */
+struct pet_scop *pet_scop_shift_loc(struct pet_scop *scop, int offset,
+	int line)
+{
+	int i;
+
+	if (!scop)
+		return NULL;
+
+	scop->loc = pet_loc_shift(scop->loc, offset, line);
+	if (!scop->loc)
+		return pet_scop_free(scop);
+
+	for (i = 0; i < scop->n_stmt; ++i) {
+		struct pet_stmt *stmt = scop->stmts[i];
+
+		stmt->loc = pet_loc_shift(stmt->loc, offset, line);
+		stmt->body = pet_tree_shift_loc(stmt->body, offset, line);
+		if (!stmt->loc || !stmt->body)
+			return pet_scop_free(scop);
+	}
+
+	return scop;
+}
+
+/* Replace the identifier S_<nr> of "stmt" by S_<nr + shift>
+ * and add a function mapping the new statement space
+ * to the original statement space to "rename".
+ * The domain of "stmt" is assumed not to be wrapped,
+ * i.e., "stmt" is assumed not to have any arguments.
+ */
+static struct pet_stmt *stmt_shift_id(struct pet_stmt *stmt, int shift,
+	isl_union_pw_multi_aff **rename)
+{
+	isl_ctx *ctx;
+	isl_id *id;
+	isl_space *space;
+	isl_multi_aff *ma;
+	const char *name;
+	char buf[50];
+
+	if (!stmt)
+		return NULL;
+
+	ctx = isl_set_get_ctx(stmt->domain);
+	name = isl_set_get_tuple_name(stmt->domain);
+	if (!name || strncmp(name, "S_", 2) != 0)
+		isl_die(ctx, isl_error_internal,
+			"unexpected statement name", return pet_stmt_free(stmt));
+	snprintf(buf, sizeof(buf), "S_%d", atoi(name + 2) + shift);
+	id = isl_id_alloc(ctx, buf, NULL);
+
+	space = isl_space_map_from_set(isl_set_get_space(stmt->domain));
+	ma = isl_multi_aff_identity(space);
+	ma = isl_multi_aff_set_tuple_id(ma, isl_dim_in, isl_id_copy(id));
+
+	stmt->domain = isl_set_set_tuple_id(stmt->domain, id);
+	stmt->body = pet_tree_update_domain(stmt->body,
+			isl_multi_pw_aff_from_multi_aff(isl_multi_aff_copy(ma)));
+	*rename = isl_union_pw_multi_aff_add_pw_multi_aff(*rename,
+					isl_pw_multi_aff_from_multi_aff(ma));
+	if (!stmt->domain || !stmt->body)
+		return pet_stmt_free(stmt);
+
+	return stmt;
+}
+
+/* Replace the identifiers S_<nr> of the statements of "scop"
+ * by S_<nr + shift>, e.g., because "scop" is reused for a copy
+ * of the code from which it was extracted.
+ * All statements are assumed to have identifiers of this form and
+ * not to have any arguments.
+ *
+ * Besides the statements themselves, the statement identifiers
+ * also appear in the schedule and in the filters of the independences.
+ * Since implications and skip conditions do not refer
+ * to statement instances, they do not need to be updated.
+ */
+struct pet_scop *pet_scop_shift_stmt_ids(struct pet_scop *scop, int shift)
+{
+	int i;
+	isl_space *space;
+	isl_union_pw_multi_aff *rename;
+
+	if (!scop)
+		return NULL;
+	if (shift == 0)
+		return scop;
+
+	space = isl_space_params(isl_set_get_space(scop->context));
+	rename = isl_union_pw_multi_aff_empty(space);
+	for (i = 0; i < scop->n_stmt; ++i) {
+		scop->stmts[i] = stmt_shift_id(scop->stmts[i], shift, &rename);
+		if (!scop->stmts[i])
+			goto error;
+	}
+
+	scop->schedule = isl_schedule_pullback_union_pw_multi_aff(
+			    scop->schedule, isl_union_pw_multi_aff_copy(rename));
+	if (!scop->schedule)
+		goto error;
+
+	for (i = 0; i < scop->n_independence; ++i) {
+		struct pet_independence *independence;
+
+		independence = scop->independences[i];
+		independence->filter =
+		    isl_union_map_preimage_domain_union_pw_multi_aff(
+			independence->filter,
+			isl_union_pw_multi_aff_copy(rename));
+		independence->filter =
+		    isl_union_map_preimage_range_union_pw_multi_aff(
+			independence->filter,
+			isl_union_pw_multi_aff_copy(rename));
+		if (!independence->filter)
+			goto error;
+	}
+
+	isl_union_pw_multi_aff_free(rename);
+	return scop;
+error:
+	isl_union_pw_multi_aff_free(rename);
+	return pet_scop_free(scop);
+}
+
 void pet_type_dump(struct pet_type *type)
 {
 	if (!type)
@@ -1598,6 +2207,13 @@ static __isl_give isl_multi_union_pw_aff *outer_projection_mupa(
  *
  * If the domain of the schedule is empty, then there is no need
  * to insert any node.
+ *
+ * Note that the inserted band has an entry for every statement
+ * in the loop, so the work performed here at each loop level
+ * is proportional to the size of the resulting band.
+ * Postponing the construction of the bands does not reduce
+ * this work and would make it harder to decide whether
+ * a band should be inserted at all.
  */
 static __isl_give isl_schedule *schedule_embed(
 	__isl_take isl_schedule *schedule, __isl_keep isl_multi_aff *prefix)
@@ -30,6 +30,7 @@ struct pet_type *pet_type_free(struct pet_type *type);
 
 void pet_array_dump(struct pet_array *array);
 struct pet_array *pet_array_free(struct pet_array *array);
+struct pet_array *pet_array_dup(struct pet_array *array);
 
 void *pet_implication_free(struct pet_implication *implication);
 void *pet_independence_free(struct pet_independence *independence);
@@ -38,11 +39,34 @@ struct pet_scop *pet_scop_from_pet_stmt(__isl_take isl_space *space,
 	struct pet_stmt *stmt);
 struct pet_scop *pet_scop_alloc(isl_ctx *ctx);
 struct pet_scop *pet_scop_empty(__isl_take isl_space *space);
+struct pet_scop *pet_scop_dup(struct pet_scop *scop);
+struct pet_scop *pet_scop_shift_loc(struct pet_scop *scop, int offset,
+	int line);
+struct pet_scop *pet_scop_shift_stmt_ids(struct pet_scop *scop, int shift);
 struct pet_scop *pet_scop_add_seq(isl_ctx *ctx, struct pet_scop *scop1,
 	struct pet_scop *scop2);
 struct pet_scop *pet_scop_add_par(isl_ctx *ctx, struct pet_scop *scop1,
 	struct pet_scop *scop2);
 
+/* A sequence of pet_scops without skip conditions that still need
+ * to be combined into a single pet_scop.
+ * "n" is the number of pet_scops in "scops", while "size" is
+ * the number of elements for which room has been allocated.
+ */
+struct pet_scop_seq {
+	isl_ctx *ctx;
+	int n;
+	int size;
+	struct pet_scop **scops;
+};
+
+void pet_scop_seq_init(struct pet_scop_seq *seq, isl_ctx *ctx);
+void pet_scop_seq_clear(struct pet_scop_seq *seq);
+struct pet_scop *pet_scop_seq_add(struct pet_scop_seq *seq,
+	struct pet_scop *scop1, struct pet_scop *scop2);
+struct pet_scop *pet_scop_seq_flush(struct pet_scop_seq *seq,
+	struct pet_scop *scop);
+
 int pet_scop_is_equal(struct pet_scop *scop1, struct pet_scop *scop2);
 
 struct pet_scop *pet_scop_intersect_domain_prefix(struct pet_scop *scop,
@@ -0,0 +1,205 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "scop.h"
+#include "scop_cache.h"
+#include "scop_yaml.h"
+
+/* Statistics about the use of a scop cache.
+ *
+ * "hits" is the number of scops found in the cache.
+ * "misses" is the number of scops that were not found in the cache.
+ * "bytes_read" is the total size of the cache entries that were read.
+ * "bytes_written" is the total size of the cache entries that were written.
+ */
+struct scop_cache_stats {
+	long hits;
+	long misses;
+	long bytes_read;
+	long bytes_written;
+};
+
+/* An on-disk cache of scops.
+ *
+ * "dir" is the directory containing the cache entries.
+ * Each entry is stored in a file called <key>.scop in YAML format.
+ * "stats" are the statistics about the use of the cache.
+ * They are kept in memory that is shared with any worker process
+ * forked by batch_foreach and are therefore updated atomically.
+ */
+struct scop_cache {
+	char *dir;
+	struct scop_cache_stats *stats;
+};
+
+/* Create a scop cache that keeps its entries in directory "dir",
+ * which is assumed to exist.
+ */
+struct scop_cache *scop_cache_alloc(const char *dir)
+{
+	struct scop_cache *cache;
+	void *stats;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+	cache->dir = strdup(dir);
+	stats = mmap(NULL, sizeof(struct scop_cache_stats),
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+			-1, 0);
+	if (stats != MAP_FAILED)
+		cache->stats = stats;
+	if (!cache->dir || !cache->stats) {
+		scop_cache_free(cache);
+		return NULL;
+	}
+	memset(cache->stats, 0, sizeof(*cache->stats));
+
+	return cache;
+}
+
+void scop_cache_free(struct scop_cache *cache)
+{
+	if (!cache)
+		return;
+	if (cache->stats)
+		munmap(cache->stats, sizeof(struct scop_cache_stats));
+	free(cache->dir);
+	free(cache);
+}
+
+/* Return the name of the file that holds the cache entry
+ * with key "key", followed by "suffix".
+ */
+static char *entry_name(struct scop_cache *cache, const char *key,
+	const char *suffix)
+{
+	char *name;
+
+	name = malloc(strlen(cache->dir) + strlen(key) + strlen(suffix) +
+			sizeof("/.scop"));
+	if (name)
+		sprintf(name, "%s/%s.scop%s", cache->dir, key, suffix);
+	return name;
+}
+
+/* Look for the scop with key "key" in the scop cache "user".
+ * Return the scop if it is found and NULL otherwise.
+ * An entry that cannot be read is treated as a miss.
+ */
+__isl_give pet_scop *scop_cache_lookup(isl_ctx *ctx, const char *key,
+	void *user)
+{
+	struct scop_cache *cache = user;
+	struct pet_scop *scop = NULL;
+	char *name;
+	FILE *in;
+
+	name = entry_name(cache, key, "");
+	in = name ? fopen(name, "r") : NULL;
+	free(name);
+	if (in) {
+		long size = -1;
+
+		if (fseek(in, 0, SEEK_END) == 0)
+			size = ftell(in);
+		rewind(in);
+		scop = pet_scop_parse(ctx, in);
+		if (scop && size > 0)
+			__sync_fetch_and_add(&cache->stats->bytes_read, size);
+		fclose(in);
+	}
+
+	if (scop)
+		__sync_fetch_and_add(&cache->stats->hits, 1);
+	else
+		__sync_fetch_and_add(&cache->stats->misses, 1);
+
+	return scop;
+}
+
+/* Store "scop" in the scop cache "user" under key "key".
+ * The scop is first written to a temporary file that is then
+ * renamed such that concurrent readers never see a partial entry.
+ */
+isl_stat scop_cache_store(const char *key, __isl_keep pet_scop *scop,
+	void *user)
+{
+	struct scop_cache *cache = user;
+	char suffix[32];
+	char *tmp, *name;
+	FILE *out;
+	long size;
+	int r;
+
+	snprintf(suffix, sizeof(suffix), ".%ld", (long) getpid());
+	tmp = entry_name(cache, key, suffix);
+	name = entry_name(cache, key, "");
+	out = tmp && name ? fopen(tmp, "w") : NULL;
+	if (!out) {
+		free(tmp);
+		free(name);
+		return isl_stat_error;
+	}
+	r = pet_scop_emit(out, scop);
+	size = ftell(out);
+	if (fclose(out) != 0)
+		r = -1;
+	if (r >= 0 && rename(tmp, name) < 0)
+		r = -1;
+	if (r < 0)
+		remove(tmp);
+	else
+		__sync_fetch_and_add(&cache->stats->bytes_written, size);
+	free(tmp);
+	free(name);
+
+	return r < 0 ? isl_stat_error : isl_stat_ok;
+}
+
+/* Print the statistics about the use of "cache" to "out".
+ */
+void scop_cache_print_stats(FILE *out, struct scop_cache *cache)
+{
+	struct scop_cache_stats *stats = cache->stats;
+
+	fprintf(out, "scop cache: %ld hits, %ld misses, "
+		"%ld bytes read, %ld bytes written\n",
+		stats->hits, stats->misses,
+		stats->bytes_read, stats->bytes_written);
+}
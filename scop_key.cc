@@ -0,0 +1,165 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/MD5.h>
+
+#include "clang_compatibility.h"
+#include "scop_key.h"
+#include "summary_db.h"
+
+using namespace std;
+using namespace clang;
+
+/* Add "decl" to the queue of declarations that need to be described,
+ * unless it is local to a function (in which case it is described
+ * as part of that function) or it has been added before.
+ * For functions, the definition is described, if available,
+ * such that the description includes the function body.
+ * Similarly for tag types.
+ * An enumeration constant is described through its enumeration type.
+ */
+void pet_scop_key::add_decl(Decl *decl)
+{
+	if (!decl)
+		return;
+	if (EnumConstantDecl *ecd = dyn_cast<EnumConstantDecl>(decl))
+		decl = dyn_cast<EnumDecl>(ecd->getDeclContext());
+	if (!decl || decl->getDeclContext()->isFunctionOrMethod())
+		return;
+
+	if (FunctionDecl *fd = dyn_cast<FunctionDecl>(decl)) {
+		const FunctionDecl *def;
+		if (fd->hasBody(def))
+			decl = const_cast<FunctionDecl *>(def);
+	} else if (TagDecl *td = dyn_cast<TagDecl>(decl)) {
+		if (td->getDefinition())
+			decl = td->getDefinition();
+	}
+
+	if (!decls.insert(decl->getCanonicalDecl()).second)
+		return;
+	queue.push_back(decl);
+}
+
+/* Add the declarations on which the canonical form of "type" depends,
+ * i.e., the definitions of any structure, union or enumeration types,
+ * possibly as the element type of an array or the target of a pointer.
+ * Typedefs are resolved by taking the canonical type.
+ */
+void pet_scop_key::add_type(QualType type)
+{
+	const Type *t;
+
+	if (type.isNull())
+		return;
+	t = type.getCanonicalType().getTypePtr();
+	if (!types.insert(t).second)
+		return;
+
+	if (const TagType *tt = dyn_cast<TagType>(t))
+		add_decl(tt->getDecl());
+	else if (const PointerType *pt = dyn_cast<PointerType>(t))
+		add_type(pt->getPointeeType());
+	else if (const ArrayType *at = dyn_cast<ArrayType>(t))
+		add_type(at->getElementType());
+}
+
+/* Set "offset" and "line" to the offset and line number
+ * of the start of the function definition "fd" in the input.
+ */
+void pet_scop_key_position(SourceManager &SM, FunctionDecl *fd,
+	unsigned &offset, unsigned &line)
+{
+	SourceLocation begin = SM.getExpansionLoc(begin_loc(fd));
+
+	offset = SM.getFileOffset(begin);
+	line = SM.getExpansionLineNumber(begin);
+}
+
+/* Write the position of the function definition "fd" in the input,
+ * relative to this->origin_offset and this->origin_line,
+ * along with the text of the definition, to this->os.
+ */
+void pet_scop_key::describe_source(FunctionDecl *fd)
+{
+	SourceLocation begin = SM.getExpansionLoc(begin_loc(fd));
+	SourceLocation end = SM.getExpansionLoc(end_loc(fd));
+	FileID file = SM.getFileID(begin);
+	unsigned start = SM.getFileOffset(begin);
+	unsigned stop = SM.getFileOffset(end);
+	StringRef buffer = SM.getBufferData(file);
+
+	os << (long) start - (long) origin_offset << " "
+	   << (long) SM.getExpansionLineNumber(begin) - (long) origin_line
+	   << "\n";
+	if (SM.getFileID(end) == file && start <= stop && stop < buffer.size())
+		os << buffer.substr(start, stop - start + 1) << "\n";
+}
+
+/* Write a description of "fd" and of all the declarations
+ * it depends on to this->os.
+ * The dependences are collected by traversing each declaration
+ * that is described, such that, in particular, the bodies of
+ * called functions are also taken into account.
+ */
+void pet_scop_key::describe(FunctionDecl *fd)
+{
+	add_decl(fd);
+	for (size_t i = 0; i < queue.size(); ++i) {
+		FunctionDecl *def = dyn_cast<FunctionDecl>(queue[i]);
+
+		queue[i]->print(os);
+		os << "\n";
+		if (def && def->hasBody())
+			describe_source(def);
+		else if (def && summaries)
+			os << pet_summary_db_read_raw(summaries, def) << "\n";
+		TraverseDecl(queue[i]);
+	}
+}
+
+/* Return a hash of "s" in the form of a string of hexadecimal digits.
+ */
+std::string pet_scop_key_hash(const std::string &s)
+{
+	llvm::MD5 hash;
+	llvm::MD5::MD5Result result;
+	llvm::SmallString<32> str;
+
+	hash.update(s);
+	hash.final(result);
+	llvm::MD5::stringifyResult(result, str);
+
+	return std::string(str.begin(), str.end());
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#ifndef PET_SCOP_KEY_H
+#define PET_SCOP_KEY_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <llvm/Support/raw_ostream.h>
+#include <clang/Basic/SourceManager.h>
+#include <clang/AST/ASTContext.h>
+#include <clang/AST/Decl.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/Type.h>
+#include <clang/AST/RecursiveASTVisitor.h>
+
+/* Structure for describing a function along with all the declarations
+ * that it (transitively) depends on, for use in the key
+ * of a scop cache entry.
+ * The declarations are described by printing them, meaning that
+ * the description refers to the code after preprocessing.
+ * Since the locations of the statements in a scop are recorded
+ * in the scop, function definitions are also described
+ * by their position and their text in the input.
+ * Functions without a body are described by their summary
+ * in the summary database, if any.
+ *
+ * "SM" is the SourceManager of the input.
+ * "summaries" is the directory of the summary database (or NULL).
+ * "os" is the stream to which the description is written.
+ * "decls" contains the (canonical) declarations that have been
+ * added to "queue".
+ * "types" contains the canonical types that have already been handled.
+ * "queue" contains the declarations that need to be described,
+ * in the order in which they were found.
+ * The positions of function definitions are described relative
+ * to "origin_offset" and "origin_line", which are zero by default.
+ */
+struct pet_scop_key : clang::RecursiveASTVisitor<pet_scop_key> {
+	clang::SourceManager &SM;
+	const char *summaries;
+	llvm::raw_ostream &os;
+	std::set<clang::Decl *> decls;
+	std::set<const clang::Type *> types;
+	std::vector<clang::Decl *> queue;
+	unsigned origin_offset;
+	unsigned origin_line;
+
+	pet_scop_key(clang::SourceManager &SM, const char *summaries,
+		llvm::raw_ostream &os) : SM(SM), summaries(summaries), os(os),
+		origin_offset(0), origin_line(0) {}
+
+	void add_decl(clang::Decl *decl);
+	void add_type(clang::QualType type);
+	void describe_source(clang::FunctionDecl *fd);
+	void describe(clang::FunctionDecl *fd);
+
+	bool VisitDeclRefExpr(clang::DeclRefExpr *expr) {
+		add_decl(expr->getDecl());
+		return true;
+	}
+	bool VisitExpr(clang::Expr *expr) {
+		add_type(expr->getType());
+		return true;
+	}
+	bool VisitUnaryExprOrTypeTraitExpr(
+		clang::UnaryExprOrTypeTraitExpr *expr) {
+		if (expr->isArgumentType())
+			add_type(expr->getArgumentType());
+		return true;
+	}
+	bool VisitValueDecl(clang::ValueDecl *decl) {
+		add_type(decl->getType());
+		return true;
+	}
+};
+
+void pet_scop_key_position(clang::SourceManager &SM,
+	clang::FunctionDecl *fd, unsigned &offset, unsigned &line);
+std::string pet_scop_key_hash(const std::string &s);
+
+#endif
@@ -42,6 +42,7 @@
 #include "loc.h"
 #include "scop.h"
 #include "skip.h"
+#include "stats.h"
 #include "tree.h"
 
 /* Do we need to construct a skip condition of the given type
@@ -267,6 +268,8 @@ void pet_skip_info_if_init(struct pet_skip_info *skip, isl_ctx *ctx,
 
 /* If we need to construct a skip condition of the given type,
  * then do so now, within the context "pc".
+ * The construction is recorded in a trace span,
+ * if trace events are being collected.
  *
  * "mpa" represents the if condition.
  */
@@ -281,11 +284,13 @@ static void pet_skip_info_if_extract_type(struct pet_skip_info *skip,
 
 	space = pet_context_get_space(pc);
 	skip->index[type] = pet_create_test_index(space, state->n_test++);
+	pet_stats_trace_start(state->stats, "extract_skip_if", -1);
 	skip->scop[type] = extract_skip_if(isl_multi_pw_aff_copy(mpa),
 				isl_multi_pw_aff_copy(skip->index[type]),
 				skip->u.i.scop_then, skip->u.i.scop_else,
 				skip->type == pet_skip_if_else, type,
 				pc, state);
+	pet_stats_trace_stop(state->stats);
 }
 
 /* Construct the required skip conditions within the context "pc",
@@ -496,6 +501,8 @@ void pet_skip_info_seq_init(struct pet_skip_info *skip, isl_ctx *ctx,
 
 /* If we need to construct a skip condition of the given type,
  * then do so now, within the context "pc".
+ * The construction is recorded in a trace span,
+ * if trace events are being collected.
  */
 static void pet_skip_info_seq_extract_type(struct pet_skip_info *skip,
 	enum pet_skip type, __isl_keep pet_context *pc, struct pet_state *state)
@@ -507,10 +514,12 @@ static void pet_skip_info_seq_extract_type(struct pet_skip_info *skip,
 
 	space = pet_context_get_space(pc);
 	skip->index[type] = pet_create_test_index(space, state->n_test++);
+	pet_stats_trace_start(state->stats, "extract_skip_seq", -1);
 	skip->scop[type] = extract_skip_seq(
 				isl_multi_pw_aff_copy(skip->index[type]),
 				skip->u.s.scop1, skip->u.s.scop2, type,
 				pc, state);
+	pet_stats_trace_stop(state->stats);
 }
 
 /* Construct the required skip conditions within the context "pc".
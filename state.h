@@ -1,6 +1,7 @@
 #ifndef PET_STATE_H
 #define PET_STATE_H
 
+#include <isl/hash.h>
 #include <pet.h>
 
 #if defined(__cplusplus)
@@ -13,6 +14,13 @@ extern "C" {
  * used to create a pet_array corresponding to the variable accessed
  * by "access".
  * "int_size" is the number of bytes needed to represent an integer.
+ * "stats" collects trace events, if it is not NULL.
+ * "memo" maps pairs of loop-free pet_trees and pet_contexts
+ * to the pet_scops extracted from them.
+ * "memo_roots" contains the roots of the maximal loop-free subtrees
+ * of the input tree, each referring to the element of "memo_groups"
+ * that describes all subtrees equal to the root.
+ * These are NULL if the memoize option is not set.
  *
  * "n_loop" is the sequence number of the next loop.
  * "n_stmt" is the sequence number of the next statement.
@@ -25,6 +33,10 @@ struct pet_state {
 		__isl_keep pet_context *pc, void *user);
 	void *user;
 	int int_size;
+	pet_stats *stats;
+	struct isl_hash_table *memo;
+	struct isl_hash_table *memo_roots;
+	struct isl_hash_table *memo_groups;
 
 	int n_loop;
 	int n_stmt;
@@ -0,0 +1,569 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <isl/ctx.h>
+
+#include "stats.h"
+
+/* Statistics are collected per function, where a function
+ * is identified by the name of the input file and the name
+ * of the function.  Time spent outside of any function,
+ * e.g., while parsing, is attributed to the empty function name.
+ */
+typedef std::pair<std::string, std::string> pet_stats_key;
+
+/* The wall clock and CPU time spent in a phase, in seconds.
+ */
+struct pet_stats_time {
+	double wall;
+	double cpu;
+
+	pet_stats_time() : wall(0), cpu(0) {}
+};
+
+/* The statistics of a single function.
+ *
+ * "phases" contains the time spent in each phase.
+ * The remaining fields count the extracted scops and
+ * the total numbers of statements, arrays and implications in them.
+ */
+struct pet_stats_function {
+	std::map<std::string, pet_stats_time> phases;
+	int n_scop;
+	int n_stmt;
+	int n_array;
+	int n_implication;
+
+	pet_stats_function() : n_scop(0), n_stmt(0), n_array(0),
+		n_implication(0) {}
+};
+
+/* A phase that has been started, but not yet stopped.
+ * "child" is the time spent in phases that were started
+ * (and stopped) while this phase was active.
+ */
+struct pet_stats_timer {
+	pet_stats_key key;
+	std::string phase;
+	pet_stats_time start;
+	pet_stats_time child;
+};
+
+/* A trace span that has been started, but not yet stopped.
+ * "line" is the line in the input to which the span corresponds,
+ * or -1 if there is no such line.
+ */
+struct pet_stats_span {
+	std::string name;
+	int line;
+	double start;
+};
+
+/* Statistics collected during extractions.
+ *
+ * "file" and "function" identify the function currently being processed.
+ * "order" contains the keys of "functions" in the order
+ * in which they were first encountered and
+ * "phases" contains the names of the phases in the order
+ * in which they were first started.
+ * "active" is the stack of phases that are currently active.
+ * The time spent in a phase does not include the time spent
+ * in phases that are started while it is active.
+ *
+ * If "trace" is not NULL, then a trace event is written to this file
+ * for each phase and for each trace span, with thread identifier "tid".
+ * "spans" is the stack of trace spans that are currently active.
+ */
+struct pet_stats {
+	isl_ctx *ctx;
+	FILE *trace;
+	int tid;
+	std::vector<pet_stats_span> spans;
+	std::string file;
+	std::string function;
+	std::map<pet_stats_key, pet_stats_function> functions;
+	std::vector<pet_stats_key> order;
+	std::vector<std::string> phases;
+	std::vector<pet_stats_timer> active;
+};
+
+/* Return the current time.
+ * The CPU time is that of the current thread, if available,
+ * since extractions may be performed from several threads.
+ */
+static pet_stats_time now()
+{
+	pet_stats_time t;
+	std::chrono::duration<double> wall;
+
+	wall = std::chrono::steady_clock::now().time_since_epoch();
+	t.wall = wall.count();
+#ifdef CLOCK_THREAD_CPUTIME_ID
+	struct timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+		t.cpu = ts.tv_sec + 1e-9 * ts.tv_nsec;
+		return t;
+	}
+#endif
+	t.cpu = (double) clock() / CLOCKS_PER_SEC;
+	return t;
+}
+
+/* The thread identifier of the next pet_stats object
+ * in trace events.  pet_stats objects may be allocated
+ * from several threads.
+ */
+static std::atomic<int> next_tid(1);
+
+/* Allocate an empty pet_stats object.
+ */
+__isl_give pet_stats *pet_stats_alloc(isl_ctx *ctx)
+{
+	pet_stats *stats;
+
+	if (!ctx)
+		return NULL;
+
+	stats = new pet_stats;
+	stats->ctx = ctx;
+	isl_ctx_ref(ctx);
+	stats->trace = NULL;
+	stats->tid = next_tid++;
+
+	return stats;
+}
+
+/* Free "stats" and return NULL.
+ */
+__isl_null pet_stats *pet_stats_free(__isl_take pet_stats *stats)
+{
+	if (!stats)
+		return NULL;
+
+	isl_ctx_deref(stats->ctx);
+	delete stats;
+
+	return NULL;
+}
+
+/* Remove all statistics collected so far from "stats".
+ * It is an error to call this function while a phase is active.
+ */
+isl_stat pet_stats_reset(__isl_keep pet_stats *stats)
+{
+	if (!stats)
+		return isl_stat_error;
+	if (!stats->active.empty())
+		isl_die(stats->ctx, isl_error_invalid,
+			"phase still active", return isl_stat_error);
+	stats->functions.clear();
+	stats->order.clear();
+	stats->phases.clear();
+	return isl_stat_ok;
+}
+
+/* Set the name of the input file that is currently being processed.
+ * This also resets the current function.
+ */
+void pet_stats_set_file(pet_stats *stats, const char *file)
+{
+	if (!stats)
+		return;
+	stats->file = file ? file : "";
+	stats->function.clear();
+}
+
+/* Set the name of the function that is currently being processed.
+ * An empty name means that no particular function is being processed.
+ */
+void pet_stats_set_function(pet_stats *stats, const std::string &function)
+{
+	if (!stats)
+		return;
+	stats->function = function;
+}
+
+/* Return the statistics of the function identified by "key",
+ * creating them if needed.
+ */
+static pet_stats_function &get_function(pet_stats *stats,
+	const pet_stats_key &key)
+{
+	std::map<pet_stats_key, pet_stats_function>::iterator it;
+
+	it = stats->functions.find(key);
+	if (it != stats->functions.end())
+		return it->second;
+	stats->order.push_back(key);
+	return stats->functions[key];
+}
+
+/* Record the extraction of "scop" from the current function.
+ */
+void pet_stats_add_scop(pet_stats *stats, pet_scop *scop)
+{
+	pet_stats_key key;
+
+	if (!stats || !scop)
+		return;
+	key = pet_stats_key(stats->file, stats->function);
+	pet_stats_function &f = get_function(stats, key);
+	f.n_scop++;
+	f.n_stmt += scop->n_stmt;
+	f.n_array += scop->n_array;
+	f.n_implication += scop->n_implication;
+}
+
+/* Return "s" as a JSON string.
+ */
+static std::string json_string(const std::string &s)
+{
+	std::string res = "\"";
+	char buf[8];
+
+	for (size_t i = 0; i < s.size(); ++i) {
+		unsigned char c = s[i];
+		if (c == '"' || c == '\\') {
+			res += '\\';
+			res += c;
+		} else if (c < 0x20) {
+			snprintf(buf, sizeof(buf), "\\u%04x", c);
+			res += buf;
+		} else
+			res += c;
+	}
+	return res + "\"";
+}
+
+/* Write a complete trace event called "name" that started
+ * at wall clock time "start" and ended at "end" to stats->trace,
+ * with arguments "args", a sequence of comma separated JSON members.
+ * The event is written in the JSON array format of the trace event format
+ * used by Chrome and Perfetto, which allows the closing bracket
+ * of the array to be omitted.
+ * Each event is written out as a single line, followed by a comma.
+ * The times are expressed in microseconds.
+ */
+static void write_event(pet_stats *stats, const std::string &name,
+	double start, double end, const std::string &args)
+{
+	fprintf(stats->trace, "{\"name\":%s,\"cat\":\"pet\",\"ph\":\"X\","
+		"\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,"
+		"\"args\":{%s}},\n", json_string(name).c_str(),
+		1e6 * start, 1e6 * (end - start), (int) getpid(), stats->tid,
+		args.c_str());
+}
+
+/* Write trace events for the phases and trace spans of "stats" to "out",
+ * or stop writing trace events if "out" is NULL.
+ * The caller is responsible for writing the opening bracket
+ * of the array of trace events.
+ */
+isl_stat pet_stats_set_trace(__isl_keep pet_stats *stats, FILE *out)
+{
+	if (!stats)
+		return isl_stat_error;
+	stats->trace = out;
+	return isl_stat_ok;
+}
+
+/* Start a trace span called "name" corresponding to line "line"
+ * of the input (or no particular line if "line" is negative).
+ * Unlike phases, trace spans do not contribute to the statistics.
+ * They only produce trace events.
+ */
+void pet_stats_trace_start(pet_stats *stats, const char *name,
+	int line)
+{
+	pet_stats_span span;
+
+	if (!stats || !stats->trace)
+		return;
+	span.name = name;
+	span.line = line;
+	span.start = now().wall;
+	stats->spans.push_back(span);
+}
+
+/* Stop the most recently started trace span and
+ * write out the corresponding trace event.
+ */
+void pet_stats_trace_stop(pet_stats *stats)
+{
+	char buf[32];
+	std::string args;
+
+	if (!stats || !stats->trace || stats->spans.empty())
+		return;
+
+	pet_stats_span span = stats->spans.back();
+	stats->spans.pop_back();
+	if (span.line >= 0) {
+		snprintf(buf, sizeof(buf), "\"line\":%d", span.line);
+		args = buf;
+	}
+	write_event(stats, span.name, span.start, now().wall, args);
+}
+
+/* Start phase "phase" of the current function.
+ * Phases may be nested.  The time spent in a nested phase
+ * is only attributed to the nested phase.
+ */
+isl_stat pet_stats_start(__isl_keep pet_stats *stats, const char *phase)
+{
+	pet_stats_timer timer;
+	std::vector<std::string>::iterator it;
+
+	if (!stats || !phase)
+		return isl_stat_error;
+	for (it = stats->phases.begin(); it != stats->phases.end(); ++it)
+		if (*it == phase)
+			break;
+	if (it == stats->phases.end())
+		stats->phases.push_back(phase);
+	timer.key = pet_stats_key(stats->file, stats->function);
+	timer.phase = phase;
+	timer.start = now();
+	stats->active.push_back(timer);
+	return isl_stat_ok;
+}
+
+/* Stop the most recently started phase that is still active.
+ */
+isl_stat pet_stats_stop(__isl_keep pet_stats *stats)
+{
+	pet_stats_time end = now();
+	pet_stats_time elapsed;
+
+	if (!stats)
+		return isl_stat_error;
+	if (stats->active.empty())
+		isl_die(stats->ctx, isl_error_invalid,
+			"no active phase", return isl_stat_error);
+
+	pet_stats_timer timer = stats->active.back();
+	stats->active.pop_back();
+	elapsed.wall = end.wall - timer.start.wall;
+	elapsed.cpu = end.cpu - timer.start.cpu;
+
+	pet_stats_time &t = get_function(stats, timer.key).phases[timer.phase];
+	t.wall += elapsed.wall - timer.child.wall;
+	t.cpu += elapsed.cpu - timer.child.cpu;
+	if (!stats->active.empty()) {
+		stats->active.back().child.wall += elapsed.wall;
+		stats->active.back().child.cpu += elapsed.cpu;
+	}
+
+	if (stats->trace)
+		write_event(stats, timer.phase, timer.start.wall, end.wall,
+			"\"file\":" + json_string(timer.key.first) +
+			",\"function\":" + json_string(timer.key.second));
+
+	return isl_stat_ok;
+}
+
+/* Return the peak memory usage of the process in kilobytes,
+ * or -1 if it cannot be determined.
+ */
+static long peak_memory()
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return -1;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+/* Return the total time spent in all phases of "f".
+ */
+static pet_stats_time total(const pet_stats_function &f)
+{
+	pet_stats_time t;
+	std::map<std::string, pet_stats_time>::const_iterator it;
+
+	for (it = f.phases.begin(); it != f.phases.end(); ++it) {
+		t.wall += it->second.wall;
+		t.cpu += it->second.cpu;
+	}
+	return t;
+}
+
+/* Return the total time spent in phase "phase" over all functions.
+ */
+static pet_stats_time phase_total(pet_stats *stats, const std::string &phase)
+{
+	pet_stats_time t;
+	std::map<pet_stats_key, pet_stats_function>::iterator it;
+	std::map<std::string, pet_stats_time>::iterator it_phase;
+
+	for (it = stats->functions.begin(); it != stats->functions.end(); ++it) {
+		it_phase = it->second.phases.find(phase);
+		if (it_phase == it->second.phases.end())
+			continue;
+		t.wall += it_phase->second.wall;
+		t.cpu += it_phase->second.cpu;
+	}
+	return t;
+}
+
+/* Print "stats" to "out" in human readable form.
+ * First print the time spent in each phase, over all functions,
+ * and then the time spent in each function along with
+ * the numbers of scops, statements, arrays and implications
+ * extracted from the function.
+ */
+static void print_table(pet_stats *stats, FILE *out)
+{
+	pet_stats_time sum;
+	std::vector<std::string>::iterator it;
+	std::vector<pet_stats_key>::iterator it_key;
+
+	fprintf(out, "%-24s %10s %10s\n", "phase", "wall (s)", "cpu (s)");
+	for (it = stats->phases.begin(); it != stats->phases.end(); ++it) {
+		pet_stats_time t = phase_total(stats, *it);
+		fprintf(out, "%-24s %10.4f %10.4f\n", it->c_str(),
+			t.wall, t.cpu);
+		sum.wall += t.wall;
+		sum.cpu += t.cpu;
+	}
+	fprintf(out, "%-24s %10.4f %10.4f\n", "total", sum.wall, sum.cpu);
+
+	fprintf(out, "\n%-24s %10s %10s %6s %6s %6s %6s\n", "function",
+		"wall (s)", "cpu (s)", "scops", "stmts", "arrays", "impls");
+	for (it_key = stats->order.begin(); it_key != stats->order.end();
+	     ++it_key) {
+		pet_stats_function &f = stats->functions[*it_key];
+		std::string name;
+		pet_stats_time t;
+
+		if (it_key->second.empty())
+			continue;
+		name = it_key->first + ":" + it_key->second;
+		t = total(f);
+		fprintf(out, "%-24s %10.4f %10.4f %6d %6d %6d %6d\n",
+			name.c_str(), t.wall, t.cpu, f.n_scop, f.n_stmt,
+			f.n_array, f.n_implication);
+	}
+
+	fprintf(out, "\npeak memory: %ld kB\n", peak_memory());
+}
+
+/* Print "s" to "out" as a JSON string.
+ */
+static void print_json_string(FILE *out, const std::string &s)
+{
+	fputs(json_string(s).c_str(), out);
+}
+
+/* Print the time "t" to "out" as a JSON object.
+ */
+static void print_json_time(FILE *out, const pet_stats_time &t)
+{
+	fprintf(out, "{\"wall\":%.6f,\"cpu\":%.6f}", t.wall, t.cpu);
+}
+
+/* Print "stats" to "out" as a single line JSON object, such that
+ * the reports of several extractions can be concatenated.
+ */
+static void print_json(pet_stats *stats, FILE *out)
+{
+	std::vector<std::string>::iterator it;
+	std::vector<pet_stats_key>::iterator it_key;
+	std::map<std::string, pet_stats_time>::iterator it_phase;
+
+	fprintf(out, "{\"phases\":{");
+	for (it = stats->phases.begin(); it != stats->phases.end(); ++it) {
+		if (it != stats->phases.begin())
+			fputc(',', out);
+		print_json_string(out, *it);
+		fputc(':', out);
+		print_json_time(out, phase_total(stats, *it));
+	}
+	fprintf(out, "},\"functions\":[");
+	for (it_key = stats->order.begin(); it_key != stats->order.end();
+	     ++it_key) {
+		pet_stats_function &f = stats->functions[*it_key];
+
+		if (it_key != stats->order.begin())
+			fputc(',', out);
+		fprintf(out, "{\"file\":");
+		print_json_string(out, it_key->first);
+		fprintf(out, ",\"function\":");
+		print_json_string(out, it_key->second);
+		fprintf(out, ",\"time\":");
+		print_json_time(out, total(f));
+		fprintf(out, ",\"phases\":{");
+		for (it_phase = f.phases.begin(); it_phase != f.phases.end();
+		     ++it_phase) {
+			if (it_phase != f.phases.begin())
+				fputc(',', out);
+			print_json_string(out, it_phase->first);
+			fputc(':', out);
+			print_json_time(out, it_phase->second);
+		}
+		fprintf(out, "},\"scops\":%d,\"statements\":%d,"
+			"\"arrays\":%d,\"implications\":%d}",
+			f.n_scop, f.n_stmt, f.n_array, f.n_implication);
+	}
+	fprintf(out, "],\"peak_memory_kb\":%ld}\n", peak_memory());
+}
+
+/* Print "stats" to "out", in JSON form if "json" is set and
+ * in human readable form otherwise.
+ */
+isl_stat pet_stats_print(__isl_keep pet_stats *stats, FILE *out, int json)
+{
+	if (!stats || !out)
+		return isl_stat_error;
+	if (json)
+		print_json(stats, out);
+	else
+		print_table(stats, out);
+	return isl_stat_ok;
+}
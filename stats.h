@@ -0,0 +1,76 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#ifndef PET_STATS_H
+#define PET_STATS_H
+
+#include <pet.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+void pet_stats_trace_start(pet_stats *stats, const char *name, int line);
+void pet_stats_trace_stop(pet_stats *stats);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#if defined(__cplusplus)
+
+#include <string>
+
+void pet_stats_set_file(pet_stats *stats, const char *file);
+void pet_stats_set_function(pet_stats *stats, const std::string &function);
+void pet_stats_add_scop(pet_stats *stats, pet_scop *scop);
+
+/* Attribute the time spent during the lifetime of an object
+ * of this type to phase "phase" of "stats" (if not NULL).
+ */
+struct pet_stats_phase {
+	pet_stats *stats;
+
+	pet_stats_phase(pet_stats *stats, const char *phase) : stats(stats) {
+		if (stats)
+			pet_stats_start(stats, phase);
+	}
+	~pet_stats_phase() {
+		if (stats)
+			pet_stats_stop(stats);
+	}
+};
+
+#endif
+
+#endif
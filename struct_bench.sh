@@ -0,0 +1,76 @@
+#!/bin/sh
+# Compare the time spent on extracting a scop that accesses variables
+# of many different struct types against that of a baseline pet,
+# e.g., one built from an earlier version.
+# Each struct type has a typedef and a field of the previous struct type,
+# such that all of them need to be collected and printed in the scop.
+# The script fails if the extract phase reported by --stats takes
+# more CPU time than that of the baseline or if the two versions
+# do not produce identical output.
+#
+# usage: struct_bench.sh <baseline pet> [path to pet] [number of struct types]
+
+test $# -ge 1 || {
+	echo "usage: $0 <baseline pet> [path to pet] [number of struct types]" >&2
+	exit 1
+}
+base=$1
+pet=${2:-./pet}
+n=${3:-4000}
+tmp=${TMPDIR:-/tmp}/struct_bench_$$
+file=$tmp.c
+
+{
+	echo "struct s0 {"
+	echo "	int a;"
+	echo "};"
+	i=1
+	while [ $i -lt $n ]; do
+		echo "struct s$i {"
+		echo "	int a;"
+		echo "	struct s$((i - 1)) f;"
+		echo "};"
+		echo "typedef struct s$i t$i;"
+		i=$((i + 1))
+	done
+	echo
+	echo "void f()"
+	echo "{"
+	i=1
+	while [ $i -lt $n ]; do
+		echo "	t$i v$i;"
+		i=$((i + 1))
+	done
+	echo "#pragma scop"
+	i=1
+	while [ $i -lt $n ]; do
+		echo "	v$i.f.a = $i;"
+		i=$((i + 1))
+	done
+	echo "#pragma endscop"
+	echo "}"
+} > $file
+
+# Run "$1" on "file", writing the scop to "$2" and printing
+# the CPU time spent in the extract phase.
+extract_time()
+{
+	$1 --stats $file > $2 2> $tmp.log || return
+	awk '$1 == "extract" { print $3 }' $tmp.log
+}
+
+old=$(extract_time $base $tmp.base.scop) &&
+	new=$(extract_time $pet $tmp.scop) &&
+	cmp -s $tmp.base.scop $tmp.scop
+r=$?
+rm -f $file $tmp.log $tmp.base.scop $tmp.scop
+test $r -eq 0 || {
+	echo "extraction failed or output differs from baseline" >&2
+	exit 1
+}
+
+echo "$n struct types: baseline $old s, current $new s"
+awk -v old=$old -v new=$new 'BEGIN { exit !(new <= old) }' || {
+	echo "extraction is slower than the baseline" >&2
+	exit 1
+}
@@ -31,7 +31,12 @@
  * Ecole Normale Superieure.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <isl/ctx.h>
+#include <isl/aff.h>
+#include <isl/map.h>
 #include <isl/printer.h>
 #include <isl/id.h>
 #include <isl/space.h>
@@ -266,6 +271,37 @@ error:
 	return pet_function_summary_free(summary);
 }
 
+/* Mark the argument at position "pos" of "summary" as an array argument
+ * with the given access relations, which are assumed to be in
+ * the form produced by pet_function_summary_set_array.
+ */
+static __isl_give pet_function_summary *set_array_access(
+	__isl_take pet_function_summary *summary, int pos,
+	__isl_take isl_union_map *may_read, __isl_take isl_union_map *may_write,
+	__isl_take isl_union_map *must_write)
+{
+	if (!summary || !may_read || !may_write || !must_write)
+		goto error;
+
+	if (pos < 0 || pos >= summary->n)
+		isl_die(summary->ctx, isl_error_invalid,
+			"position out of bounds", goto error);
+
+	free_arg(&summary->arg[pos]);
+
+	summary->arg[pos].type = pet_arg_array;
+	summary->arg[pos].access[pet_expr_access_may_read] = may_read;
+	summary->arg[pos].access[pet_expr_access_may_write] = may_write;
+	summary->arg[pos].access[pet_expr_access_must_write] = must_write;
+
+	return summary;
+error:
+	isl_union_map_free(may_read);
+	isl_union_map_free(may_write);
+	isl_union_map_free(must_write);
+	return pet_function_summary_free(summary);
+}
+
 /* Has the argument of "summary" at position "pos" been marked
  * as an integer argument?
  */
@@ -382,3 +418,223 @@ void pet_function_summary_dump(__isl_keep pet_function_summary *summary)
 
 	isl_printer_free(p);
 }
+
+/* Write "summary" to "out" in a line based format that can be read back
+ * by pet_function_summary_read.
+ * The first line contains the number of arguments.
+ * Each argument is then described by a line containing its type,
+ * followed, for an integer argument, by the name of its identifier and,
+ * for an array argument, by lines containing the may-read, may-write and
+ * must-write access relations.
+ *
+ * Return 0 on success and -1 on error.
+ */
+int pet_function_summary_write(__isl_keep pet_function_summary *summary,
+	FILE *out)
+{
+	int i;
+	enum pet_expr_access_type type;
+
+	if (!summary)
+		return -1;
+
+	fprintf(out, "%d\n", summary->n);
+	for (i = 0; i < summary->n; ++i) {
+		switch (summary->arg[i].type) {
+		case pet_arg_int:
+			fprintf(out, "int %s\n",
+				isl_id_get_name(summary->arg[i].id));
+			break;
+		case pet_arg_other:
+			fprintf(out, "other\n");
+			break;
+		case pet_arg_array:
+			fprintf(out, "array\n");
+			for (type = pet_expr_access_begin;
+			     type < pet_expr_access_end; ++type) {
+				char *str;
+
+				str = isl_union_map_to_str(
+					summary->arg[i].access[type]);
+				if (!str)
+					return -1;
+				fprintf(out, "%s\n", str);
+				free(str);
+			}
+			break;
+		}
+	}
+
+	return ferror(out) ? -1 : 0;
+}
+
+/* Read a line from "in" into "*line", which has size "*size",
+ * without the terminating newline.
+ * Return -1 if no line could be read.
+ */
+static int read_line(FILE *in, char **line, size_t *size)
+{
+	ssize_t len;
+
+	len = getline(line, size, in);
+	if (len < 0)
+		return -1;
+	if (len > 0 && (*line)[len - 1] == '\n')
+		(*line)[len - 1] = '\0';
+	return 0;
+}
+
+/* Read a pet_function_summary from "in" in the format produced
+ * by pet_function_summary_write.
+ * The identifiers of the integer arguments do not refer
+ * to any declaration.  Similarly, the identifiers in the access
+ * relations have no user pointers.
+ */
+__isl_give pet_function_summary *pet_function_summary_read(isl_ctx *ctx,
+	FILE *in)
+{
+	pet_function_summary *summary;
+	char *line = NULL;
+	size_t size = 0;
+	int i, n;
+
+	if (read_line(in, &line, &size) < 0 || sscanf(line, "%d", &n) != 1 ||
+	    n < 0) {
+		free(line);
+		isl_die(ctx, isl_error_invalid, "invalid function summary",
+			return NULL);
+	}
+
+	summary = pet_function_summary_alloc(ctx, n);
+	for (i = 0; summary && i < n; ++i) {
+		isl_union_map *access[pet_expr_access_end];
+		enum pet_expr_access_type type;
+
+		if (read_line(in, &line, &size) < 0)
+			break;
+		if (!strncmp(line, "int ", 4)) {
+			isl_id *id = isl_id_alloc(ctx, line + 4, NULL);
+			summary = pet_function_summary_set_int(summary, i, id);
+			continue;
+		}
+		if (!strcmp(line, "other"))
+			continue;
+		if (strcmp(line, "array"))
+			break;
+		for (type = pet_expr_access_begin;
+		     type < pet_expr_access_end; ++type) {
+			access[type] = NULL;
+			if (read_line(in, &line, &size) >= 0)
+				access[type] =
+				    isl_union_map_read_from_str(ctx, line);
+		}
+		summary = set_array_access(summary, i,
+				access[pet_expr_access_may_read],
+				access[pet_expr_access_may_write],
+				access[pet_expr_access_must_write]);
+	}
+	free(line);
+
+	if (summary && i < n)
+		isl_die(ctx, isl_error_invalid, "invalid function summary",
+			return pet_function_summary_free(summary));
+
+	return summary;
+}
+
+/* Internal data structure for pet_function_summary_reset_ids.
+ *
+ * "space_fn", "param_fn" and "user" are the arguments passed
+ * to that function.
+ * "pos" is the position of the array argument that is being handled.
+ * "res" collects the results.
+ */
+struct pet_summary_reset_data {
+	__isl_give isl_space *(*space_fn)(__isl_take isl_space *space,
+		int pos, void *user);
+	__isl_give isl_id *(*param_fn)(__isl_take isl_id *id, void *user);
+	void *user;
+	int pos;
+	isl_union_map *res;
+};
+
+/* Replace the identifiers of the parameters of "map" by the result
+ * of calling data->param_fn on them and replace the space of the range
+ * of "map" by the result of calling data->space_fn on that space.
+ * Add the result to data->res.
+ * The replacement of the range space is performed by taking
+ * the preimage of "map" under the identity function
+ * from the new space to the old space.
+ */
+static isl_stat reset_map_ids(__isl_take isl_map *map, void *user)
+{
+	struct pet_summary_reset_data *data = user;
+	isl_space *space, *new_space;
+	isl_multi_aff *ma;
+	int i, n;
+
+	n = isl_map_dim(map, isl_dim_param);
+	for (i = 0; i < n; ++i) {
+		isl_id *id;
+
+		id = isl_map_get_dim_id(map, isl_dim_param, i);
+		id = data->param_fn(id, data->user);
+		map = isl_map_set_dim_id(map, isl_dim_param, i, id);
+	}
+
+	space = isl_space_range(isl_map_get_space(map));
+	new_space = data->space_fn(isl_space_copy(space), data->pos,
+					data->user);
+	space = isl_space_map_from_domain_and_range(new_space, space);
+	ma = isl_multi_aff_identity(space);
+	map = isl_map_preimage_range_multi_aff(map, ma);
+	data->res = isl_union_map_add_map(data->res, map);
+
+	return data->res ? isl_stat_ok : isl_stat_error;
+}
+
+/* Replace the identifiers in the access relations of each
+ * array argument of "summary".
+ * In particular, replace the space of the accessed elements
+ * by the result of calling "space_fn" on that space and
+ * the position of the argument and replace the identifier
+ * of each parameter by the result of calling "param_fn" on it.
+ * The callbacks may only change identifiers.
+ */
+__isl_give pet_function_summary *pet_function_summary_reset_ids(
+	__isl_take pet_function_summary *summary,
+	__isl_give isl_space *(*space_fn)(__isl_take isl_space *space,
+		int pos, void *user),
+	__isl_give isl_id *(*param_fn)(__isl_take isl_id *id, void *user),
+	void *user)
+{
+	struct pet_summary_reset_data data = { space_fn, param_fn, user };
+	enum pet_expr_access_type type;
+	int i;
+
+	if (!summary)
+		return NULL;
+
+	for (i = 0; i < summary->n; ++i) {
+		if (summary->arg[i].type != pet_arg_array)
+			continue;
+		data.pos = i;
+		for (type = pet_expr_access_begin;
+		     type < pet_expr_access_end; ++type) {
+			isl_union_map *umap = summary->arg[i].access[type];
+			isl_ctx *ctx = isl_union_map_get_ctx(umap);
+			isl_stat r;
+
+			data.res = isl_union_map_empty(
+					isl_space_params_alloc(ctx, 0));
+			r = isl_union_map_foreach_map(umap,
+						&reset_map_ids, &data);
+			isl_union_map_free(umap);
+			summary->arg[i].access[type] = data.res;
+			if (r < 0 || !data.res)
+				return pet_function_summary_free(summary);
+		}
+	}
+
+	return summary;
+}
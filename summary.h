@@ -1,6 +1,7 @@
 #ifndef PET_SUMMARY_H
 #define PET_SUMMARY_H
 
+#include <stdio.h>
 #include <isl/map.h>
 
 #include "expr_access_type.h"
@@ -45,6 +46,17 @@ __isl_give isl_union_map *pet_function_summary_arg_get_access(
 	__isl_keep pet_function_summary *summary, int pos,
 	enum pet_expr_access_type type);
 
+int pet_function_summary_write(__isl_keep pet_function_summary *summary,
+	FILE *out);
+__isl_give pet_function_summary *pet_function_summary_read(isl_ctx *ctx,
+	FILE *in);
+__isl_give pet_function_summary *pet_function_summary_reset_ids(
+	__isl_take pet_function_summary *summary,
+	__isl_give isl_space *(*space_fn)(__isl_take isl_space *space,
+		int pos, void *user),
+	__isl_give isl_id *(*param_fn)(__isl_take isl_id *id, void *user),
+	void *user);
+
 __isl_give isl_printer *pet_function_summary_print(
 	__isl_keep pet_function_summary *summary, __isl_take isl_printer *p);
 void pet_function_summary_dump(__isl_keep pet_function_summary *summary);
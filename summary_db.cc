@@ -0,0 +1,344 @@
+/*
+ * Copyright 2011 Leiden University. All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 
+ *    1. Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ * 
+ *    2. Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY LEIDEN UNIVERSITY ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL LEIDEN UNIVERSITY OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA,
+ * OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ * The views and conclusions contained in the software and documentation
+ * are those of the authors and should not be interpreted as
+ * representing official policies, either expressed or implied, of
+ * Leiden University.
+ */ 
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <isl/id.h>
+#include <isl/space.h>
+
+#include "clang.h"
+#include "id.h"
+#include "summary_db.h"
+
+using namespace std;
+using namespace clang;
+
+/* A summary database is a directory containing a file for each
+ * function summary that has been stored in it.
+ * The summaries are keyed by the unified symbol resolution (USR)
+ * of the function, as it would be computed by clang's indexing library,
+ * such that summaries can be shared across translation units.
+ * For C functions with external linkage, the USR only depends
+ * on the name of the function.
+ * Functions with internal linkage cannot be called from other
+ * translation units and are therefore not stored in the database.
+ */
+
+/* Compute the name of the file in the summary database "dir"
+ * holding the summary of "fd" and store it in "name".
+ * Return false if "fd" cannot be stored in the database.
+ */
+static bool summary_file_name(const char *dir, FunctionDecl *fd,
+	string &name)
+{
+	if (fd->getStorageClass() == SC_Static)
+		return false;
+
+	name = string(dir) + "/c:@F@" + fd->getNameAsString() + ".summary";
+	return true;
+}
+
+/* Return the member called "name" of the structure (or union) at the base
+ * of "type", looking inside anonymous members, or NULL
+ * if there is no such member.
+ */
+static FieldDecl *find_field(QualType type, const char *name)
+{
+	RecordDecl *record;
+	RecordDecl::field_iterator it;
+
+	type = pet_clang_base_type(type);
+	if (!name || !type->isRecordType())
+		return NULL;
+	record = pet_clang_record_decl(type)->getDefinition();
+	if (!record)
+		return NULL;
+
+	for (it = record->field_begin(); it != record->field_end(); ++it) {
+		FieldDecl *field = *it;
+
+		if (field->isAnonymousStructOrUnion()) {
+			field = find_field(field->getType(), name);
+			if (field)
+				return field;
+			continue;
+		}
+		if (field->getName() == name)
+			return field;
+	}
+
+	return NULL;
+}
+
+/* Internal data structure for rebinding the identifiers
+ * in a function summary read from a summary database.
+ *
+ * "fd" is the function declaration in the current translation unit.
+ * "failed" is set if some identifier could not be rebound.
+ */
+struct pet_summary_db_rebind_data {
+	FunctionDecl *fd;
+	bool failed;
+};
+
+/* Replace the identifiers in the space "space" of elements accessed
+ * through parameter "parm" by identifiers that refer
+ * to the corresponding declarations and set "type" to the type
+ * of the (innermost) array represented by "space".
+ *
+ * If "space" is wrapped, then it represents an access to a member
+ * of a structure, with the domain of the wrapped space representing
+ * the outer array and the range representing the member.
+ * The identifier of the wrapped space itself does not refer
+ * to any declaration.
+ * Otherwise, "space" represents an access to "parm" itself.
+ */
+static __isl_give isl_space *rebind_space(__isl_take isl_space *space,
+	ParmVarDecl *parm, QualType &type,
+	struct pet_summary_db_rebind_data *data)
+{
+	isl_ctx *ctx = isl_space_get_ctx(space);
+	isl_id *id = NULL;
+	isl_space *dom, *ran;
+	FieldDecl *field;
+
+	if (!isl_space_is_wrapping(space)) {
+		type = parm->getType();
+		id = pet_id_from_decl(ctx, parm);
+		return isl_space_set_tuple_id(space, isl_dim_set, id);
+	}
+
+	if (isl_space_has_tuple_id(space, isl_dim_set))
+		id = isl_space_get_tuple_id(space, isl_dim_set);
+	space = isl_space_unwrap(space);
+	dom = isl_space_domain(isl_space_copy(space));
+	ran = isl_space_range(space);
+	dom = rebind_space(dom, parm, type, data);
+	field = find_field(type, isl_space_get_tuple_name(ran, isl_dim_set));
+	if (field) {
+		type = field->getType();
+		ran = isl_space_set_tuple_id(ran, isl_dim_set,
+					pet_id_from_decl(ctx, field));
+	} else
+		data->failed = true;
+	space = isl_space_wrap(isl_space_map_from_domain_and_range(dom, ran));
+	if (id)
+		space = isl_space_set_tuple_id(space, isl_dim_set, id);
+
+	return space;
+}
+
+extern "C" {
+	static __isl_give isl_space *rebind_access_space(
+		__isl_take isl_space *space, int pos, void *user);
+	static __isl_give isl_id *rebind_param(__isl_take isl_id *id,
+		void *user);
+}
+
+/* Replace the identifiers in the space "space" of elements accessed
+ * through the argument at position "pos" by identifiers that refer
+ * to the corresponding declarations.
+ */
+static __isl_give isl_space *rebind_access_space(__isl_take isl_space *space,
+	int pos, void *user)
+{
+	struct pet_summary_db_rebind_data *data;
+	QualType type;
+
+	data = (struct pet_summary_db_rebind_data *) user;
+	return rebind_space(space, data->fd->getParamDecl(pos), type, data);
+}
+
+/* Replace the parameter identifier "id" by an identifier that refers
+ * to the global variable with the same name.
+ * If there is more than one declaration of this variable,
+ * then the most recent one is used.
+ */
+static __isl_give isl_id *rebind_param(__isl_take isl_id *id, void *user)
+{
+	struct pet_summary_db_rebind_data *data;
+	TranslationUnitDecl *tu;
+	DeclContext::decl_iterator it;
+	const char *name;
+	VarDecl *decl = NULL;
+	isl_ctx *ctx;
+
+	data = (struct pet_summary_db_rebind_data *) user;
+	name = isl_id_get_name(id);
+	tu = data->fd->getASTContext().getTranslationUnitDecl();
+	for (it = tu->decls_begin(); name && it != tu->decls_end(); ++it) {
+		VarDecl *vd = dyn_cast<VarDecl>(*it);
+		if (vd && vd->getName() == name)
+			decl = vd;
+	}
+	if (!decl) {
+		data->failed = true;
+		return id;
+	}
+
+	ctx = isl_id_get_ctx(id);
+	isl_id_free(id);
+	return pet_id_from_decl(ctx, decl);
+}
+
+/* Check that the summary "summary" read from a summary database
+ * is compatible with the function declaration "fd", i.e.,
+ * that it has the same number of arguments and that the integer and
+ * array arguments of "summary" are integers and arrays in "fd".
+ */
+static bool is_compatible(__isl_keep pet_function_summary *summary,
+	FunctionDecl *fd)
+{
+	unsigned n = fd->getNumParams();
+
+	if (pet_function_summary_get_n_arg(summary) != (int) n)
+		return false;
+	for (unsigned i = 0; i < n; ++i) {
+		QualType type = fd->getParamDecl(i)->getType();
+
+		if (pet_function_summary_arg_is_int(summary, i) &&
+		    !type->isIntegerType())
+			return false;
+		if (pet_function_summary_arg_is_array(summary, i) &&
+		    pet_clang_array_depth(type) == 0)
+			return false;
+	}
+
+	return true;
+}
+
+/* Load the summary of the function declared by "fd" from
+ * the summary database "dir".
+ * Return NULL if no (compatible) summary is available.
+ *
+ * The identifiers in the summary that has been read refer
+ * to names only, so they are replaced by identifiers that refer
+ * to the corresponding declarations in the current translation unit,
+ * in the same way as the identifiers in a summary that is extracted
+ * from a function body in this translation unit.
+ * If this is not possible for some identifier, then
+ * the summary is not used.
+ */
+__isl_give pet_function_summary *pet_summary_db_load(isl_ctx *ctx,
+	const char *dir, FunctionDecl *fd)
+{
+	struct pet_summary_db_rebind_data data = { fd, false };
+	pet_function_summary *summary;
+	string name;
+	FILE *in;
+
+	if (!summary_file_name(dir, fd, name))
+		return NULL;
+	in = fopen(name.c_str(), "r");
+	if (!in)
+		return NULL;
+	summary = pet_function_summary_read(ctx, in);
+	fclose(in);
+
+	if (summary && !is_compatible(summary, fd))
+		return pet_function_summary_free(summary);
+
+	for (unsigned i = 0; summary && i < fd->getNumParams(); ++i) {
+		ParmVarDecl *parm = fd->getParamDecl(i);
+
+		if (!pet_function_summary_arg_is_int(summary, i))
+			continue;
+		summary = pet_function_summary_set_int(summary, i,
+						pet_id_from_decl(ctx, parm));
+	}
+	summary = pet_function_summary_reset_ids(summary,
+				&rebind_access_space, &rebind_param, &data);
+	if (data.failed)
+		return pet_function_summary_free(summary);
+
+	return summary;
+}
+
+/* Store "summary" as the summary of the function defined by "fd"
+ * in the summary database "dir".
+ * The summary is first written to a temporary file that is then renamed
+ * such that concurrent readers never see a partially written summary.
+ * Functions that cannot be stored in the database are silently ignored.
+ */
+isl_stat pet_summary_db_store(const char *dir, FunctionDecl *fd,
+	__isl_keep pet_function_summary *summary)
+{
+	string name, tmp;
+	char suffix[32];
+	FILE *out;
+	int r;
+
+	if (!summary)
+		return isl_stat_error;
+	if (!summary_file_name(dir, fd, name))
+		return isl_stat_ok;
+
+	snprintf(suffix, sizeof(suffix), ".%ld", (long) getpid());
+	tmp = name + suffix;
+	out = fopen(tmp.c_str(), "w");
+	if (!out)
+		return isl_stat_error;
+	r = pet_function_summary_write(summary, out);
+	if (fclose(out) != 0)
+		r = -1;
+	if (r >= 0 && rename(tmp.c_str(), name.c_str()) < 0)
+		r = -1;
+	if (r < 0)
+		remove(tmp.c_str());
+
+	return r < 0 ? isl_stat_error : isl_stat_ok;
+}
+
+/* Return the contents of the entry for "fd" in the summary database "dir",
+ * or an empty string if there is no such entry.
+ */
+string pet_summary_db_read_raw(const char *dir, FunctionDecl *fd)
+{
+	string name, contents;
+	char buf[4096];
+	size_t n;
+	FILE *in;
+
+	if (!summary_file_name(dir, fd, name))
+		return contents;
+	in = fopen(name.c_str(), "r");
+	if (!in)
+		return contents;
+	while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+		contents.append(buf, n);
+	fclose(in);
+
+	return contents;
+}
@@ -0,0 +1,219 @@
+/* The extraction of the scop in f1 exceeds the isl operation budget,
+ * even with dynamic control encapsulated, for a range of budgets
+ * under which the scop in f2 can still be extracted.
+ * For some of those budgets, the summary of g is first computed
+ * while dynamic control is encapsulated.
+ * The scop in f1 is only marked if F1 is defined.
+ */
+void g(int n, int A[n], int B[n])
+{
+	for (int i = 0; i < n; ++i)
+		if (A[i] > 0)
+			B[i] = 1;
+		else
+			B[i] = 2;
+}
+
+void f1(int n, int A[n], int B[n], int C[n][n])
+{
+#ifdef F1
+#pragma scop
+#endif
+	for (int i = 0; i < n; ++i) {
+		C[i][0] = A[i];
+		if (A[C[i][0]] > 0)
+			break;
+		C[i][1] = A[i];
+		if (A[C[i][1]] > 1)
+			break;
+		C[i][2] = A[i];
+		if (A[C[i][2]] > 2)
+			break;
+		C[i][3] = A[i];
+		if (A[C[i][3]] > 3)
+			break;
+		C[i][4] = A[i];
+		if (A[C[i][4]] > 4)
+			break;
+		C[i][5] = A[i];
+		if (A[C[i][5]] > 5)
+			break;
+		C[i][6] = A[i];
+		if (A[C[i][6]] > 6)
+			break;
+		C[i][7] = A[i];
+		if (A[C[i][7]] > 7)
+			break;
+	}
+	g(n, A, B);
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 0; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 0;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 1; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 1;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 2; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 2;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 3; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 3;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 4; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 4;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 5; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 5;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 6; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 6;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 7; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 7;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 8; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 8;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 9; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 9;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 10; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 10;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 11; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 11;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 12; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 12;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 13; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 13;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 14; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 14;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 15; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 15;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 16; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 16;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 17; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 17;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 18; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 18;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 19; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 19;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 20; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 20;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 21; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 21;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 22; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 22;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 23; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 23;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 24; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 24;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 25; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 25;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 26; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 26;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 27; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 27;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 28; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 28;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 29; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 29;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 30; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 30;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 31; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 31;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 32; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 32;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 33; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 33;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 34; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 34;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 35; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 35;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 36; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 36;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 37; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 37;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 38; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 38;
+	for (int i = 0; i < n; ++i)
+		for (int j = 0; j < n; ++j)
+			for (int k = 39; k < n; ++k)
+				C[i][j] += C[j][k] * C[k][i] + 39;
+#ifdef F1
+#pragma endscop
+#endif
+}
+
+void f2(int n, int A[n], int B[n])
+{
+#pragma scop
+	g(n, A, B);
+#pragma endscop
+}
@@ -36,6 +36,7 @@
 #include <string.h>
 
 #include <isl/ctx.h>
+#include <isl/hash.h>
 #include <isl/id.h>
 #include <isl/val.h>
 #include <isl/space.h>
@@ -603,6 +604,40 @@ error:
 	return NULL;
 }
 
+/* Data used in pet_tree_shift_loc.
+ *
+ * "offset" and "line" are the amounts by which the locations
+ * need to be moved.
+ */
+struct pet_tree_shift_loc_data {
+	int offset;
+	int line;
+};
+
+/* Move the location of "tree" (but not that of its subtrees)
+ * by data->offset bytes and data->line lines.
+ */
+static __isl_give pet_tree *shift_loc(__isl_take pet_tree *tree, void *user)
+{
+	struct pet_tree_shift_loc_data *data = user;
+	pet_loc *loc;
+
+	loc = pet_tree_get_loc(tree);
+	loc = pet_loc_shift(loc, data->offset, data->line);
+	return pet_tree_set_loc(tree, loc);
+}
+
+/* Move the locations of "tree" and all its subtrees
+ * by "offset" bytes and "line" lines.
+ */
+__isl_give pet_tree *pet_tree_shift_loc(__isl_take pet_tree *tree,
+	int offset, int line)
+{
+	struct pet_tree_shift_loc_data data = { offset, line };
+
+	return pet_tree_map_top_down(tree, &shift_loc, &data);
+}
+
 /* Replace the label of "tree" by "label".
  */
 __isl_give pet_tree *pet_tree_set_label(__isl_take pet_tree *tree,
@@ -1494,6 +1529,164 @@ int pet_tree_is_equal(__isl_keep pet_tree *tree1, __isl_keep pet_tree *tree2)
 	return 1;
 }
 
+/* Return a hash value that digests "tree".
+ * Trees that are equal according to pet_tree_is_equal
+ * have the same hash value.  In particular, the locations
+ * of the trees are ignored.
+ */
+uint32_t pet_tree_get_hash(__isl_keep pet_tree *tree)
+{
+	int i;
+	uint32_t hash, hash_f;
+
+	if (!tree)
+		return 0;
+
+	hash = isl_hash_init();
+	isl_hash_byte(hash, tree->type & 0xFF);
+	if (tree->label) {
+		hash_f = isl_id_get_hash(tree->label);
+		isl_hash_hash(hash, hash_f);
+	}
+
+	switch (tree->type) {
+	case pet_tree_error:
+		return 0;
+	case pet_tree_block:
+		isl_hash_byte(hash, tree->u.b.block & 0xFF);
+		isl_hash_byte(hash, tree->u.b.n & 0xFF);
+		for (i = 0; i < tree->u.b.n; ++i) {
+			hash_f = pet_tree_get_hash(tree->u.b.child[i]);
+			isl_hash_hash(hash, hash_f);
+		}
+		break;
+	case pet_tree_break:
+	case pet_tree_continue:
+		break;
+	case pet_tree_decl:
+		hash_f = pet_expr_get_hash(tree->u.d.var);
+		isl_hash_hash(hash, hash_f);
+		break;
+	case pet_tree_decl_init:
+		hash_f = pet_expr_get_hash(tree->u.d.var);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_expr_get_hash(tree->u.d.init);
+		isl_hash_hash(hash, hash_f);
+		break;
+	case pet_tree_expr:
+	case pet_tree_return:
+		hash_f = pet_expr_get_hash(tree->u.e.expr);
+		isl_hash_hash(hash, hash_f);
+		break;
+	case pet_tree_for:
+		isl_hash_byte(hash, tree->u.l.declared & 0xFF);
+		hash_f = pet_expr_get_hash(tree->u.l.iv);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_expr_get_hash(tree->u.l.init);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_expr_get_hash(tree->u.l.cond);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_expr_get_hash(tree->u.l.inc);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_tree_get_hash(tree->u.l.body);
+		isl_hash_hash(hash, hash_f);
+		break;
+	case pet_tree_while:
+		hash_f = pet_expr_get_hash(tree->u.l.cond);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_tree_get_hash(tree->u.l.body);
+		isl_hash_hash(hash, hash_f);
+		break;
+	case pet_tree_infinite_loop:
+		hash_f = pet_tree_get_hash(tree->u.l.body);
+		isl_hash_hash(hash, hash_f);
+		break;
+	case pet_tree_if:
+		hash_f = pet_expr_get_hash(tree->u.i.cond);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_tree_get_hash(tree->u.i.then_body);
+		isl_hash_hash(hash, hash_f);
+		break;
+	case pet_tree_if_else:
+		hash_f = pet_expr_get_hash(tree->u.i.cond);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_tree_get_hash(tree->u.i.then_body);
+		isl_hash_hash(hash, hash_f);
+		hash_f = pet_tree_get_hash(tree->u.i.else_body);
+		isl_hash_hash(hash, hash_f);
+		break;
+	}
+
+	return hash;
+}
+
+/* Are the locations of "tree2" and its subtrees equal to
+ * those of "tree1" and its subtrees moved by "offset" bytes and
+ * "line" lines?
+ * The indentation is required to be the same.
+ * "tree1" and "tree2" are assumed to be equal
+ * according to pet_tree_is_equal.
+ */
+int pet_tree_is_shifted(__isl_keep pet_tree *tree1, __isl_keep pet_tree *tree2,
+	int offset, int line)
+{
+	int i;
+	int shifted;
+	int line1, line2;
+
+	if (!tree1 || !tree2)
+		return -1;
+
+	if (pet_loc_get_start(tree2->loc) !=
+			pet_loc_get_start(tree1->loc) + offset ||
+	    pet_loc_get_end(tree2->loc) != pet_loc_get_end(tree1->loc) + offset)
+		return 0;
+	line1 = pet_loc_get_line(tree1->loc);
+	line2 = pet_loc_get_line(tree2->loc);
+	if (line1 >= 0 ? line2 != line1 + line : line2 != line1)
+		return 0;
+	if (strcmp(pet_loc_get_indent(tree1->loc),
+		    pet_loc_get_indent(tree2->loc)) != 0)
+		return 0;
+
+	switch (tree1->type) {
+	case pet_tree_error:
+		return -1;
+	case pet_tree_block:
+		for (i = 0; i < tree1->u.b.n; ++i) {
+			shifted = pet_tree_is_shifted(tree1->u.b.child[i],
+					tree2->u.b.child[i], offset, line);
+			if (shifted < 0 || !shifted)
+				return shifted;
+		}
+		break;
+	case pet_tree_break:
+	case pet_tree_continue:
+	case pet_tree_decl:
+	case pet_tree_decl_init:
+	case pet_tree_expr:
+	case pet_tree_return:
+		break;
+	case pet_tree_for:
+	case pet_tree_while:
+	case pet_tree_infinite_loop:
+		return pet_tree_is_shifted(tree1->u.l.body, tree2->u.l.body,
+					offset, line);
+	case pet_tree_if:
+		return pet_tree_is_shifted(tree1->u.i.then_body,
+					tree2->u.i.then_body, offset, line);
+	case pet_tree_if_else:
+		shifted = pet_tree_is_shifted(tree1->u.i.then_body,
+					tree2->u.i.then_body, offset, line);
+		if (shifted < 0 || !shifted)
+			return shifted;
+		return pet_tree_is_shifted(tree1->u.i.else_body,
+					tree2->u.i.else_body, offset, line);
+	}
+
+	return 1;
+}
+
 /* Is "tree" an expression tree that performs the operation "type"?
  */
 static int pet_tree_is_op_of_type(__isl_keep pet_tree *tree,
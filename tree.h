@@ -89,6 +89,9 @@ const char *pet_tree_type_str(enum pet_tree_type type);
 enum pet_tree_type pet_tree_str_type(const char *str);
 
 int pet_tree_is_equal(__isl_keep pet_tree *tree1, __isl_keep pet_tree *tree2);
+uint32_t pet_tree_get_hash(__isl_keep pet_tree *tree);
+int pet_tree_is_shifted(__isl_keep pet_tree *tree1, __isl_keep pet_tree *tree2,
+	int offset, int line);
 
 int pet_tree_is_kill(__isl_keep pet_tree *tree);
 int pet_tree_is_assign(__isl_keep pet_tree *tree);
@@ -131,6 +134,8 @@ __isl_give pet_tree *pet_tree_new_if_else(__isl_take pet_expr *cond,
 
 __isl_give pet_tree *pet_tree_set_loc(__isl_take pet_tree *tree,
 	__isl_take pet_loc *loc);
+__isl_give pet_tree *pet_tree_shift_loc(__isl_take pet_tree *tree,
+	int offset, int line);
 
 int pet_tree_foreach_sub_tree(__isl_keep pet_tree *tree,
 	int (*fn)(__isl_keep pet_tree *tree, void *user), void *user);
@@ -52,8 +52,32 @@
 #include "scop.h"
 #include "skip.h"
 #include "state.h"
+#include "stats.h"
 #include "tree2scop.h"
 
+/* Start a trace span called "name" for the construction
+ * of (part of) a pet_scop from "tree", if trace events are being collected.
+ * The span is annotated with the line of "tree" in the input.
+ */
+static void trace_start(struct pet_state *state, const char *name,
+	__isl_keep pet_tree *tree)
+{
+	int line = -1;
+
+	if (!state->stats)
+		return;
+	if (tree)
+		line = pet_loc_get_line(tree->loc);
+	pet_stats_trace_start(state->stats, name, line);
+}
+
+/* Stop the trace span that was most recently started by trace_start.
+ */
+static void trace_stop(struct pet_state *state)
+{
+	pet_stats_trace_stop(state->stats);
+}
+
 /* If "stmt" is an affine assumption, then record the assumption in "pc".
  */
 static __isl_give pet_context *add_affine_assumption(struct pet_stmt *stmt,
@@ -1171,6 +1195,27 @@ static __isl_give isl_multi_aff *compute_wrapping(__isl_take isl_space *space,
 	return ma;
 }
 
+/* Is "set" obviously a universe set with the same parameters as "model"?
+ */
+static int is_plain_universe_on(__isl_keep isl_set *set,
+	__isl_keep isl_set *model)
+{
+	int universe;
+	isl_space *space, *space_model;
+
+	universe = isl_set_plain_is_universe(set);
+	if (universe < 0 || !universe)
+		return universe;
+
+	space = isl_set_get_space(set);
+	space_model = isl_set_get_space(model);
+	universe = isl_space_has_equal_params(space, space_model);
+	isl_space_free(space);
+	isl_space_free(space_model);
+
+	return universe;
+}
+
 /* Given two sets in the space
  *
  *	{ [l,i] },
@@ -1189,11 +1234,26 @@ static __isl_give isl_multi_aff *compute_wrapping(__isl_take isl_space *space,
  * i.e.,
  *
  *	not exists i: (set1 \ set2)(l,i)
+ *
+ * In the common case where "set2" is obviously a universe set
+ * (e.g., because the loop condition is defined everywhere),
+ * the result is a universe set and it is constructed directly.
  */
 static __isl_give isl_set *enforce_subset(__isl_take isl_set *set1,
 	__isl_take isl_set *set2)
 {
 	int pos;
+	int universe;
+
+	universe = is_plain_universe_on(set2, set1);
+	if (universe < 0 || universe) {
+		isl_space *space = isl_set_get_space(set1);
+		isl_set_free(set1);
+		isl_set_free(set2);
+		if (universe < 0)
+			space = isl_space_free(space);
+		return isl_set_universe(space);
+	}
 
 	pos = isl_set_dim(set1, isl_dim_set) - 1;
 	set1 = isl_set_subtract(set1, set2);
@@ -1208,15 +1268,30 @@ static __isl_give isl_set *enforce_subset(__isl_take isl_set *set1,
  * to the outer loop iterators), plug that into "cond"
  * and then compute the set of outer iterators for which "dom" is a subset
  * of the result.
+ * If "cond" is obviously a universe set, then so is the result of
+ * plugging in the mapping, so this step can be skipped.
  */
 static __isl_give isl_set *valid_on_next(__isl_take isl_set *cond,
 	__isl_take isl_set *dom, __isl_take isl_val *inc)
 {
 	int pos;
+	int universe;
 	isl_space *space;
 	isl_aff *aff;
 	isl_multi_aff *ma;
 
+	universe = is_plain_universe_on(cond, dom);
+	if (universe < 0) {
+		isl_set_free(cond);
+		isl_set_free(dom);
+		isl_val_free(inc);
+		return NULL;
+	}
+	if (universe) {
+		isl_val_free(inc);
+		return enforce_subset(dom, cond);
+	}
+
 	pos = isl_set_dim(dom, isl_dim_set) - 1;
 	space = isl_set_get_space(dom);
 	space = isl_space_map_from_set(space);
@@ -1855,6 +1930,7 @@ static __isl_give pet_scop *scop_from_affine_for_init(__isl_keep pet_tree *tree,
 static struct pet_scop *scop_from_for(__isl_keep pet_tree *tree,
 	__isl_keep pet_context *init_pc, struct pet_state *state)
 {
+	struct pet_scop *scop;
 	isl_id *iv;
 	isl_val *inc;
 	isl_pw_aff *pa_inc, *init_val;
@@ -1877,9 +1953,13 @@ static struct pet_scop *scop_from_for(__isl_keep pet_tree *tree,
 	if (!pa_inc || !init_val || !inc)
 		goto error;
 	if (!isl_pw_aff_involves_nan(pa_inc) &&
-	    !isl_pw_aff_involves_nan(init_val) && !isl_val_is_nan(inc))
-		return scop_from_affine_for_init(tree, init_val, pa_inc, inc,
+	    !isl_pw_aff_involves_nan(init_val) && !isl_val_is_nan(inc)) {
+		trace_start(state, "scop_from_affine_for", tree);
+		scop = scop_from_affine_for_init(tree, init_val, pa_inc, inc,
 						init_pc, pc, state);
+		trace_stop(state);
+		return scop;
+	}
 
 	isl_pw_aff_free(pa_inc);
 	isl_pw_aff_free(init_val);
@@ -1889,7 +1969,10 @@ static struct pet_scop *scop_from_for(__isl_keep pet_tree *tree,
 	pc = pet_context_copy(init_pc);
 	pc = pet_context_add_infinite_loop(pc);
 	pc = pet_context_clear_writes_in_tree(pc, tree->u.l.body);
-	return scop_from_non_affine_for(tree, init_pc, pc, state);
+	trace_start(state, "scop_from_non_affine_for", tree);
+	scop = scop_from_non_affine_for(tree, init_pc, pc, state);
+	trace_stop(state);
+	return scop;
 error:
 	isl_pw_aff_free(pa_inc);
 	isl_pw_aff_free(init_val);
@@ -2489,6 +2572,22 @@ static struct pet_scop *mark_exposed(struct pet_scop *scop)
  * If "block" is not set, then any array declared by one of the statements
  * in the sequence is marked as being exposed.
  *
+ * The statements are handled strictly in order, even if a statement
+ * does not depend on the changes to "pc" made by its predecessors.
+ * Besides "pc", the construction of each statement also depends on
+ * the sequence numbers of statements, loops and virtual scalars in "state"
+ * and all objects involved live in the same isl_ctx.
+ * Extraction can only be performed concurrently at a coarser level,
+ * i.e., for different input files or, through the partitions
+ * of a pet_session, for different functions in the same input.
+ *
+ * The pet_scops of the individual statements are combined
+ * through a pet_scop_seq object such that long sequences of statements
+ * without breaks or continues are combined in a single pass at the end.
+ * Since the pet_scops that are collected in this object
+ * do not have any skip conditions, the skip conditions of "scop"
+ * are those of the entire sequence constructed so far.
+ *
  * If autodetect is set, then we allow the extraction of only a subrange
  * of the sequence of statements.  However, if there is at least one statement
  * for which we could not construct a scop and the final range contains
@@ -2503,8 +2602,10 @@ static struct pet_scop *scop_from_block(__isl_keep pet_tree *tree,
 	isl_space *space;
 	isl_set *domain;
 	struct pet_scop *scop, *kills;
+	struct pet_scop_seq seq;
 
 	ctx = pet_tree_get_ctx(tree);
+	pet_scop_seq_init(&seq, ctx);
 
 	space = pet_context_get_space(pc);
 	domain = pet_context_get_domain(pc);
@@ -2533,7 +2634,7 @@ static struct pet_scop *scop_from_block(__isl_keep pet_tree *tree,
 			} else
 				scop_i = mark_exposed(scop_i);
 		}
-		scop = pet_scop_add_seq(ctx, scop, scop_i);
+		scop = pet_scop_seq_add(&seq, scop, scop_i);
 
 		scop = pet_skip_info_add(&skip, scop);
 
@@ -2542,7 +2643,8 @@ static struct pet_scop *scop_from_block(__isl_keep pet_tree *tree,
 	}
 	isl_set_free(domain);
 
-	scop = pet_scop_add_seq(ctx, scop, kills);
+	scop = pet_scop_seq_add(&seq, scop, kills);
+	scop = pet_scop_seq_flush(&seq, scop);
 
 	pet_context_free(pc);
 
@@ -2656,6 +2758,40 @@ static struct pet_scop *scop_from_tree_macro(__isl_take pet_tree *tree,
 	return data.scop;
 }
 
+/* Return the name of the function that constructs a pet_scop
+ * from a pet_tree of type "type", for use as the name of a trace span.
+ */
+static const char *scop_from_tree_name(enum pet_tree_type type)
+{
+	switch (type) {
+	case pet_tree_block:
+		return "scop_from_block";
+	case pet_tree_break:
+		return "scop_from_break";
+	case pet_tree_continue:
+		return "scop_from_continue";
+	case pet_tree_decl:
+	case pet_tree_decl_init:
+		return "scop_from_decl";
+	case pet_tree_expr:
+		return "scop_from_tree_expr";
+	case pet_tree_return:
+		return "scop_from_return";
+	case pet_tree_if:
+	case pet_tree_if_else:
+		return "scop_from_if";
+	case pet_tree_for:
+		return "scop_from_for";
+	case pet_tree_while:
+		return "scop_from_while";
+	case pet_tree_infinite_loop:
+		return "scop_from_infinite_for";
+	case pet_tree_error:
+		break;
+	}
+	return "scop_from_tree";
+}
+
 /* Construct a pet_scop that corresponds to the pet_tree "tree"
  * within the context "pc" by calling the appropriate function
  * based on the type of "tree".
@@ -2670,7 +2806,7 @@ static struct pet_scop *scop_from_tree_macro(__isl_take pet_tree *tree,
  * in the encapsulation.  We therefore postpone the encapsulation
  * until we have constructed a pet_scop for this enclosing loop.
  */
-static struct pet_scop *scop_from_tree(__isl_keep pet_tree *tree,
+static struct pet_scop *scop_from_tree_type(__isl_keep pet_tree *tree,
 	__isl_keep pet_context *pc, struct pet_state *state)
 {
 	isl_ctx *ctx;
@@ -2720,7 +2856,486 @@ static struct pet_scop *scop_from_tree(__isl_keep pet_tree *tree,
 		return scop;
 
 	pet_scop_free(scop);
-	return scop_from_tree_macro(pet_tree_copy(tree), pc, state);
+	trace_start(state, "scop_from_tree_macro", tree);
+	scop = scop_from_tree_macro(pet_tree_copy(tree), pc, state);
+	trace_stop(state);
+	return scop;
+}
+
+/* Construct a pet_scop that corresponds to the pet_tree "tree"
+ * within the context "pc", recording the construction
+ * in a trace span named after the function that handles
+ * the type of "tree".
+ */
+static struct pet_scop *scop_from_tree_traced(__isl_keep pet_tree *tree,
+	__isl_keep pet_context *pc, struct pet_state *state)
+{
+	struct pet_scop *scop;
+
+	trace_start(state, scop_from_tree_name(tree->type), tree);
+	scop = scop_from_tree_type(tree, pc, state);
+	trace_stop(state);
+
+	return scop;
+}
+
+/* An entry in state->memo.
+ *
+ * "scop" was extracted from "tree" within the context "pc".
+ * "first_stmt" is the sequence number of the first statement
+ * that was created during this extraction, while
+ * "n_stmt" is the number of statement sequence numbers
+ * that were consumed.
+ */
+struct pet_scop_memo_entry {
+	pet_tree *tree;
+	pet_context *pc;
+	struct pet_scop *scop;
+	int first_stmt;
+	int n_stmt;
+};
+
+/* The key of a lookup in state->memo.
+ */
+struct pet_scop_memo_key {
+	pet_tree *tree;
+	pet_context *pc;
+};
+
+/* Free the pet_scop_memo_entry pointed to by "entry".
+ */
+static isl_stat free_memo_entry(void **entry, void *user)
+{
+	struct pet_scop_memo_entry *memo = *entry;
+
+	pet_tree_free(memo->tree);
+	pet_context_free(memo->pc);
+	pet_scop_free(memo->scop);
+	free(memo);
+
+	return isl_stat_ok;
+}
+
+/* Does the pet_scop_memo_entry "entry" have the pet_tree and pet_context
+ * of the pet_scop_memo_key "val"?
+ */
+static isl_bool has_memo_key(const void *entry, const void *val)
+{
+	const struct pet_scop_memo_entry *memo = entry;
+	const struct pet_scop_memo_key *key = val;
+	int equal;
+
+	equal = pet_tree_is_equal(memo->tree, key->tree);
+	if (equal < 0 || !equal)
+		return equal;
+	return pet_context_is_equal(memo->pc, key->pc);
+}
+
+/* A group of equal maximal loop-free subtrees of the input tree.
+ *
+ * "tree" is one of these subtrees and "hash" is its hash value.
+ * "n" is the number of occurrences of such subtrees in the input tree.
+ */
+struct pet_scop_memo_group {
+	pet_tree *tree;
+	uint32_t hash;
+	int n;
+};
+
+/* The root "tree" of a maximal loop-free subtree of the input tree,
+ * belonging to "group".
+ */
+struct pet_scop_memo_root {
+	pet_tree *tree;
+	struct pet_scop_memo_group *group;
+};
+
+/* Free the pet_scop_memo_group pointed to by "entry".
+ */
+static isl_stat free_memo_group(void **entry, void *user)
+{
+	struct pet_scop_memo_group *group = *entry;
+
+	pet_tree_free(group->tree);
+	free(group);
+
+	return isl_stat_ok;
+}
+
+/* Free the pet_scop_memo_root pointed to by "entry".
+ */
+static isl_stat free_memo_root(void **entry, void *user)
+{
+	struct pet_scop_memo_root *root = *entry;
+
+	pet_tree_free(root->tree);
+	free(root);
+
+	return isl_stat_ok;
+}
+
+/* Is the tree of the pet_scop_memo_group "entry" equal to "val"?
+ */
+static isl_bool has_memo_group_tree(const void *entry, const void *val)
+{
+	const struct pet_scop_memo_group *group = entry;
+
+	return pet_tree_is_equal(group->tree, (pet_tree *) val);
+}
+
+/* Is the pet_scop_memo_root "entry" the root "val"?
+ */
+static isl_bool is_memo_root(const void *entry, const void *val)
+{
+	const struct pet_scop_memo_root *root = entry;
+
+	return root->tree == val ? isl_bool_true : isl_bool_false;
+}
+
+/* Return the hash value of the pointer "tree"
+ * for use as a key in state->memo_roots.
+ */
+static uint32_t memo_root_hash(__isl_keep pet_tree *tree)
+{
+	uint32_t hash;
+
+	hash = isl_hash_init();
+	isl_hash_builtin(hash, tree);
+	return hash;
+}
+
+/* Add "tree" to state->memo_roots as the root
+ * of a maximal loop-free subtree and count it in the element
+ * of state->memo_groups of the subtrees equal to "tree".
+ *
+ * The hash value of "tree" is only computed here, such that
+ * each node of the input tree is only considered once.
+ */
+static isl_stat add_memo_root(__isl_keep pet_tree *tree,
+	struct pet_state *state)
+{
+	uint32_t hash;
+	struct isl_hash_table_entry *entry;
+	struct pet_scop_memo_group *group;
+	struct pet_scop_memo_root *root;
+
+	hash = pet_tree_get_hash(tree);
+	entry = isl_hash_table_find(state->ctx, state->memo_groups, hash,
+				    &has_memo_group_tree, tree, 1);
+	if (!entry)
+		return isl_stat_error;
+	if (!entry->data) {
+		group = isl_calloc_type(state->ctx, struct pet_scop_memo_group);
+		if (!group) {
+			isl_hash_table_remove(state->ctx, state->memo_groups,
+						entry);
+			return isl_stat_error;
+		}
+		group->tree = pet_tree_copy(tree);
+		group->hash = hash;
+		entry->data = group;
+	}
+	group = entry->data;
+	group->n++;
+
+	hash = memo_root_hash(tree);
+	entry = isl_hash_table_find(state->ctx, state->memo_roots, hash,
+				    &is_memo_root, tree, 1);
+	if (!entry)
+		return isl_stat_error;
+	if (entry->data)
+		return isl_stat_ok;
+	root = isl_calloc_type(state->ctx, struct pet_scop_memo_root);
+	if (!root) {
+		isl_hash_table_remove(state->ctx, state->memo_roots, entry);
+		return isl_stat_error;
+	}
+	root->tree = pet_tree_copy(tree);
+	root->group = group;
+	entry->data = root;
+
+	return isl_stat_ok;
+}
+
+/* Return the number of children of "tree".
+ */
+static int tree_n_child(__isl_keep pet_tree *tree)
+{
+	switch (tree->type) {
+	case pet_tree_block:
+		return tree->u.b.n;
+	case pet_tree_for:
+	case pet_tree_infinite_loop:
+	case pet_tree_while:
+	case pet_tree_if:
+		return 1;
+	case pet_tree_if_else:
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+/* Return child "pos" of "tree".
+ */
+static __isl_keep pet_tree *tree_child(__isl_keep pet_tree *tree, int pos)
+{
+	switch (tree->type) {
+	case pet_tree_block:
+		return tree->u.b.child[pos];
+	case pet_tree_for:
+	case pet_tree_infinite_loop:
+	case pet_tree_while:
+		return tree->u.l.body;
+	default:
+		return pos == 0 ? tree->u.i.then_body : tree->u.i.else_body;
+	}
+}
+
+/* Collect the roots of the maximal loop-free subtrees of "tree"
+ * in state->memo_roots, except for "tree" itself.
+ * Return 1 if "tree" is loop-free, 0 if it is not and -1 on error.
+ *
+ * A tree is considered loop-free if it does not contain any loops
+ * or labels.
+ * Loops are excluded because they consume loop numbers that would
+ * need to be updated in the schedule of a reused pet_scop.
+ * Labels are excluded because a labeled statement cannot be duplicated.
+ *
+ * The loop-free children of a tree that is not itself loop-free
+ * are the roots of maximal loop-free subtrees.
+ * Since it is only known whether "tree" is loop-free after
+ * all its children have been considered, the results
+ * for the children are kept in "loop_free".
+ */
+static int collect_memo_roots(__isl_keep pet_tree *tree,
+	struct pet_state *state)
+{
+	int i, n;
+	int *loop_free;
+	int tree_loop_free;
+
+	if (!tree)
+		return -1;
+
+	tree_loop_free = !tree->label && tree->type != pet_tree_for &&
+	    tree->type != pet_tree_while &&
+	    tree->type != pet_tree_infinite_loop;
+	n = tree_n_child(tree);
+	loop_free = isl_alloc_array(state->ctx, int, n);
+	if (n && !loop_free)
+		return -1;
+	for (i = 0; i < n; ++i) {
+		loop_free[i] = collect_memo_roots(tree_child(tree, i), state);
+		if (loop_free[i] < 0)
+			goto error;
+		if (!loop_free[i])
+			tree_loop_free = 0;
+	}
+	for (i = 0; !tree_loop_free && i < n; ++i) {
+		if (!loop_free[i])
+			continue;
+		if (add_memo_root(tree_child(tree, i), state) < 0)
+			goto error;
+	}
+
+	free(loop_free);
+	return tree_loop_free;
+error:
+	free(loop_free);
+	return -1;
+}
+
+/* Initialize the memo tables in "state" for extracting a pet_scop
+ * from the input tree "tree".
+ * In particular, collect the roots of the maximal loop-free subtrees
+ * of "tree", including "tree" itself if it is loop-free.
+ */
+static isl_stat memo_init(__isl_keep pet_tree *tree, struct pet_state *state)
+{
+	int loop_free;
+
+	state->memo = isl_hash_table_alloc(state->ctx, 0);
+	state->memo_roots = isl_hash_table_alloc(state->ctx, 0);
+	state->memo_groups = isl_hash_table_alloc(state->ctx, 0);
+	if (!state->memo || !state->memo_roots || !state->memo_groups)
+		return isl_stat_error;
+
+	loop_free = collect_memo_roots(tree, state);
+	if (loop_free < 0)
+		return isl_stat_error;
+	if (loop_free)
+		return add_memo_root(tree, state);
+	return isl_stat_ok;
+}
+
+/* Free the memo tables in "state", along with all their entries.
+ */
+static void memo_free(struct pet_state *state)
+{
+	isl_ctx *ctx = state->ctx;
+
+	if (state->memo) {
+		isl_hash_table_foreach(ctx, state->memo, &free_memo_entry,
+					NULL);
+		isl_hash_table_free(ctx, state->memo);
+	}
+	if (state->memo_roots) {
+		isl_hash_table_foreach(ctx, state->memo_roots,
+					&free_memo_root, NULL);
+		isl_hash_table_free(ctx, state->memo_roots);
+	}
+	if (state->memo_groups) {
+		isl_hash_table_foreach(ctx, state->memo_groups,
+					&free_memo_group, NULL);
+		isl_hash_table_free(ctx, state->memo_groups);
+	}
+}
+
+/* Do all statements of "scop" lack arguments?
+ * Statements with arguments have a wrapped domain that
+ * is not handled by pet_scop_shift_stmt_ids.
+ */
+static int has_plain_stmts(struct pet_scop *scop)
+{
+	int i;
+
+	for (i = 0; i < scop->n_stmt; ++i)
+		if (scop->stmts[i]->n_arg > 0)
+			return 0;
+	return 1;
+}
+
+/* Reuse the pet_scop stored in "memo" for "tree", which is equal
+ * to memo->tree (except possibly for the locations) and
+ * which appears in the same context.
+ *
+ * If the locations in "tree" are not simply those in memo->tree
+ * moved by a fixed amount, then a fresh pet_scop is constructed instead.
+ * Otherwise, the locations in a copy of the stored pet_scop
+ * are moved by this amount and the statements are renumbered
+ * such that they receive the sequence numbers that would have been
+ * assigned by a fresh extraction.
+ */
+static struct pet_scop *reuse_memo(struct pet_scop_memo_entry *memo,
+	__isl_keep pet_tree *tree, __isl_keep pet_context *pc,
+	struct pet_state *state)
+{
+	int offset, line;
+	int line1, line2;
+	int shifted;
+	struct pet_scop *scop;
+
+	offset = (int) pet_loc_get_start(tree->loc) -
+			(int) pet_loc_get_start(memo->tree->loc);
+	line1 = pet_loc_get_line(memo->tree->loc);
+	line2 = pet_loc_get_line(tree->loc);
+	line = line1 >= 0 && line2 >= 0 ? line2 - line1 : 0;
+	shifted = pet_tree_is_shifted(memo->tree, tree, offset, line);
+	if (shifted < 0)
+		return NULL;
+	if (!shifted)
+		return scop_from_tree_traced(tree, pc, state);
+
+	scop = pet_scop_dup(memo->scop);
+	scop = pet_scop_shift_loc(scop, offset, line);
+	scop = pet_scop_shift_stmt_ids(scop,
+					state->n_stmt - memo->first_stmt);
+	state->n_stmt += memo->n_stmt;
+
+	return scop;
+}
+
+/* Construct a pet_scop that corresponds to the loop-free pet_tree "tree"
+ * with hash value "tree_hash" within the context "pc",
+ * reusing the result of an earlier extraction
+ * from an identical tree in the same context, if any.
+ *
+ * The result of a fresh extraction is only stored in state->memo
+ * if it can be reused by simply renumbering its statements.
+ * In particular, no virtual scalars should have been created
+ * during the extraction since their names would also need to be updated.
+ */
+static struct pet_scop *scop_from_tree_memo(__isl_keep pet_tree *tree,
+	uint32_t tree_hash, __isl_keep pet_context *pc,
+	struct pet_state *state)
+{
+	uint32_t hash, hash_f;
+	int first_stmt, n_test;
+	struct pet_scop_memo_key key = { tree, pc };
+	struct pet_scop_memo_entry *memo;
+	struct isl_hash_table_entry *entry;
+	struct pet_scop *scop;
+
+	hash = isl_hash_init();
+	isl_hash_hash(hash, tree_hash);
+	hash_f = pet_context_get_hash(pc);
+	isl_hash_hash(hash, hash_f);
+	entry = isl_hash_table_find(state->ctx, state->memo, hash,
+				    &has_memo_key, &key, 0);
+	if (!entry)
+		return NULL;
+	if (entry != isl_hash_table_entry_none)
+		return reuse_memo(entry->data, tree, pc, state);
+
+	first_stmt = state->n_stmt;
+	n_test = state->n_test;
+	scop = scop_from_tree_traced(tree, pc, state);
+	if (!scop || state->n_test != n_test || !has_plain_stmts(scop))
+		return scop;
+
+	entry = isl_hash_table_find(state->ctx, state->memo, hash,
+				    &has_memo_key, &key, 1);
+	if (!entry)
+		return pet_scop_free(scop);
+	memo = isl_calloc_type(state->ctx, struct pet_scop_memo_entry);
+	if (!memo) {
+		isl_hash_table_remove(state->ctx, state->memo, entry);
+		return pet_scop_free(scop);
+	}
+	memo->tree = pet_tree_copy(tree);
+	memo->pc = pet_context_copy(pc);
+	memo->scop = pet_scop_dup(scop);
+	memo->first_stmt = first_stmt;
+	memo->n_stmt = state->n_stmt - first_stmt;
+	entry->data = memo;
+	if (!memo->scop)
+		return pet_scop_free(scop);
+
+	return scop;
+}
+
+/* Construct a pet_scop that corresponds to the pet_tree "tree"
+ * within the context "pc".
+ *
+ * If the memoize option is set and "tree" is the root
+ * of a maximal loop-free subtree of the input tree that
+ * is equal to some other such subtree, then the result
+ * may be taken from state->memo.
+ * Other subtrees are not memoized since they are either not
+ * loop-free, part of a larger loop-free subtree or unique.
+ */
+static struct pet_scop *scop_from_tree(__isl_keep pet_tree *tree,
+	__isl_keep pet_context *pc, struct pet_state *state)
+{
+	struct isl_hash_table_entry *entry;
+	struct pet_scop_memo_root *root;
+
+	if (!tree)
+		return NULL;
+
+	if (!state->memo)
+		return scop_from_tree_traced(tree, pc, state);
+	entry = isl_hash_table_find(state->ctx, state->memo_roots,
+				    memo_root_hash(tree), &is_memo_root, tree, 0);
+	if (!entry)
+		return NULL;
+	if (entry == isl_hash_table_entry_none)
+		return scop_from_tree_traced(tree, pc, state);
+	root = entry->data;
+	if (root->group->n < 2)
+		return scop_from_tree_traced(tree, pc, state);
+	return scop_from_tree_memo(tree, root->group->hash, pc, state);
 }
 
 /* If "tree" has a label that is of the form S_<nr>, then make
@@ -2751,16 +3366,22 @@ static int set_first_stmt(__isl_keep pet_tree *tree, void *user)
  * "int_size" is the number of bytes need to represent an integer.
  * "extract_array" is a callback that we can use to create a pet_array
  * that corresponds to the variable accessed by an expression.
+ * If "stats" is not NULL, then trace spans are recorded in "stats"
+ * for the construction of the pet_scops corresponding to
+ * the subtrees of "tree".
  *
  * Initialize the global state, construct a context and then
  * construct the pet_scop by recursively visiting the tree.
+ * If the memoize option is set, then the pet_scops extracted
+ * from repeated maximal loop-free subtrees are kept in a memo table
+ * for the duration of this construction.
  *
  * state.n_stmt is initialized to point beyond any explicit S_<nr> label.
  */
 struct pet_scop *pet_scop_from_pet_tree(__isl_take pet_tree *tree, int int_size,
 	struct pet_array *(*extract_array)(__isl_keep pet_expr *access,
 		__isl_keep pet_context *pc, void *user), void *user,
-	__isl_keep pet_context *pc)
+	__isl_keep pet_context *pc, pet_stats *stats)
 {
 	struct pet_scop *scop;
 	struct pet_state state = { 0 };
@@ -2772,12 +3393,17 @@ struct pet_scop *pet_scop_from_pet_tree(__isl_take pet_tree *tree, int int_size,
 	state.int_size = int_size;
 	state.extract_array = extract_array;
 	state.user = user;
+	state.stats = stats;
+	if (pet_options_get_memoize(state.ctx) == 1 &&
+	    memo_init(tree, &state) < 0)
+		tree = pet_tree_free(tree);
 	if (pet_tree_foreach_sub_tree(tree, &set_first_stmt, &state) < 0)
 		tree = pet_tree_free(tree);
 
 	scop = scop_from_tree(tree, pc, &state);
 	scop = pet_scop_set_loc(scop, pet_tree_get_loc(tree));
 
+	memo_free(&state);
 	pet_tree_free(tree);
 
 	if (scop)
@@ -10,7 +10,7 @@ extern "C" {
 struct pet_scop *pet_scop_from_pet_tree(__isl_take pet_tree *tree, int int_size,
 	struct pet_array *(*extract_array)(__isl_keep pet_expr *iterator,
 		__isl_keep pet_context *pc, void *user), void *user,
-	__isl_keep pet_context *pc);
+	__isl_keep pet_context *pc, pet_stats *stats);
 
 #if defined(__cplusplus)
 }
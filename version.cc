@@ -10,3 +10,11 @@ void pet_print_version(void)
 	printf("%s\n", clang::getClangFullVersion().c_str());
 	printf("%s\n", GIT_HEAD_ID);
 }
+
+/* Return an identifier of the version of pet,
+ * as obtained from git at build time.
+ */
+const char *pet_version_id(void)
+{
+	return GIT_HEAD_ID;
+}
@@ -3,6 +3,7 @@ extern "C" {
 #endif
 
 void pet_print_version(void);
+const char *pet_version_id(void);
 
 #if defined(__cplusplus)
 }